@@ -476,7 +476,7 @@ static PyObject* nb_vars(Arjun *self)
 static PyObject* get_indep_set(Arjun *self, PyObject *args, PyObject *kwds)
 {
     if (self->get_indep_called > 0) {
-        PyErr_SetString(PyExc_SystemError, "get_indep_set can only be called ONCE per Arjun object");
+        PyErr_SetString(PyExc_SystemError, "get_indep_set can only be called ONCE per Arjun object, unless reset() is called in between");
         return NULL;
     }
     self->get_indep_called++;
@@ -552,13 +552,28 @@ PyDoc_STRVAR(get_indep_set_doc,
 Return smaller independent set than given. If empty array given, all variables are taken\n\
 as independent. Otherwise, the input array determines what set needs to be minimized. \n\
 \n\
-This function can only be called ONCE per Arjun object. In other words, you must first\n\
-add all the clauses you want to, then you should call this function.\n\
+This function can only be called ONCE per Arjun object, unless reset() is called in\n\
+between. In other words, you must first add all the clauses you want to, then you\n\
+should call this function.\n\
 \n\
 :return: Smaller independent set\n\
 :rtype: <array <Longs>>"
 );
 
+PyDoc_STRVAR(reset_doc,
+"reset()\n\
+Forget all clauses and the independent set, so that a new formula can be\n\
+added and get_indep_set() called again. Settings are kept."
+);
+
+static PyObject* reset(Arjun *self)
+{
+    self->arjun->reset();
+    self->get_indep_called = 0;
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
 /*************************** Method definitions *************************/
 
 static PyMethodDef Arjun_methods[] = {
@@ -567,6 +582,7 @@ static PyMethodDef Arjun_methods[] = {
     {"add_clauses", (PyCFunction) add_clauses,  METH_VARARGS | METH_KEYWORDS, add_clauses_doc},
     {"add_xor_clause",(PyCFunction) add_xor_clause,  METH_VARARGS | METH_KEYWORDS, "adds an XOR clause to the system"},
     {"nb_vars", (PyCFunction) nb_vars, METH_VARARGS | METH_KEYWORDS, nb_vars_doc},
+    {"reset", (PyCFunction) reset, METH_NOARGS, reset_doc},
     {NULL,        NULL}  /* sentinel - marks the end of this structure */
 };
 
@@ -52,6 +52,7 @@ using namespace ArjunInt;
 DLL_PUBLIC void Arjun::set_##NAME (TYPE NAME) \
 { \
     arjdata->common.conf.NAME = NAME; \
+    arjdata->common.user_conf.NAME = NAME; \
 } \
 DLL_PUBLIC TYPE Arjun::get_##NAME () const \
 { \
@@ -83,6 +84,12 @@ DLL_PUBLIC Arjun::~Arjun()
     delete arjdata;
 }
 
+DLL_PUBLIC void Arjun::reset()
+{
+    arjdata->common.reset();
+    sampling_vars_set = false;
+}
+
 DLL_PUBLIC uint32_t Arjun::nVars() {
     return arjdata->common.solver->nVars();
 }
@@ -101,7 +108,10 @@ DLL_PUBLIC void Arjun::new_var()
 
 DLL_PUBLIC bool Arjun::add_clause(const vector<CMSat::Lit>& lits)
 {
-    check_duplicated(arjdata->common.already_duplicated);
+    if (arjdata->common.already_duplicated) {
+        check_duplicated(!arjdata->common.backward_done);
+        return arjdata->common.add_clause_incremental(lits);
+    }
     return arjdata->common.solver->add_clause(lits);
 }
 
@@ -177,16 +187,40 @@ DLL_PUBLIC const SimplifiedCNF& Arjun::get_orig_cnf() const
     return arjdata->common.orig_cnf;
 }
 
+DLL_PUBLIC const vector<PhaseStats>& Arjun::get_stats() const
+{
+    return arjdata->common.phase_stats;
+}
+
 DLL_PUBLIC const vector<uint32_t>& Arjun::get_current_indep_set() const {
     return arjdata->common.sampling_set;
 }
 
+static void timed_backward_round(Common& common) {
+    PhaseTimer phase(common.phase_stats, "backward");
+    phase.count("vars", common.sampling_set.size());
+    common.backward_round();
+    phase.count("indep", common.sampling_set.size());
+}
+
 DLL_PUBLIC vector<uint32_t> Arjun::run_backwards() {
     double start_time = cpuTime();
+    if (arjdata->common.backward_done) {
+        // Clauses may have been added since, re-check the current set only
+        if (arjdata->common.conf.verb) {
+            cout << "c [arjun] incremental backward, re-checking: "
+            << arjdata->common.sampling_set.size() << " vars" << endl;
+        }
+        if (arjdata->common.solver->okay() &&
+                !arjdata->common.orig_cnf.weighted && arjdata->common.conf.backward)
+            timed_backward_round(arjdata->common);
+        goto end;
+    }
+    arjdata->common.backward_done = true;
     arjdata->common.init();
     if (!arjdata->common.preproc_and_duplicate()) goto end;
     if (!arjdata->common.orig_cnf.weighted && arjdata->common.conf.backward)
-        arjdata->common.backward_round();
+        timed_backward_round(arjdata->common);
 
     end:
     if (arjdata->common.conf.verb) {
@@ -246,10 +280,16 @@ DLL_PUBLIC uint32_t Arjun::get_orig_num_vars() const
 DLL_PUBLIC void Arjun::set_verbosity(uint32_t verb)
 {
     arjdata->common.conf.verb = verb;
+    arjdata->common.user_conf.verb = verb;
     arjdata->common.solver->set_verbosity(verb);
 }
 
-DLL_PUBLIC void Arjun::set_seed(uint32_t seed) { arjdata->common.random_source.seed(seed); }
+DLL_PUBLIC void Arjun::set_seed(uint32_t seed)
+{
+    arjdata->common.conf.seed = seed;
+    arjdata->common.user_conf.seed = seed;
+    arjdata->common.random_source.seed(seed);
+}
 DLL_PUBLIC uint32_t Arjun::get_verbosity() const { return arjdata->common.conf.verb; }
 
 set_get_macro(bool, fast_backw)
@@ -264,20 +304,37 @@ set_get_macro(bool, xor_gates_based)
 set_get_macro(bool, probe_based)
 set_get_macro(bool, backward)
 set_get_macro(uint32_t, backw_max_confl)
+set_get_macro(uint32_t, backw_confl_start)
+set_get_macro(double, backw_confl_mult)
+set_get_macro(double, backw_max_time)
+set_get_macro(uint32_t, num_threads)
+set_get_macro(uint32_t, backw_group_max)
+set_get_macro(uint32_t, portfolio)
+set_get_macro(double, portfolio_time)
 set_get_macro(bool, gauss_jordan)
 set_get_macro(bool, ite_gate_based)
 set_get_macro(bool, irreg_gate_based)
 set_get_macro(double, no_gates_below)
 set_get_macro(std::string, specified_order_fname)
+set_get_macro(std::string, checkpoint_fname)
+set_get_macro(double, checkpoint_every)
+set_get_macro(std::string, resume_fname)
+set_get_macro(std::string, status_fname)
+set_get_macro(double, status_every)
+set_get_macro(std::string, gate_cache_dir)
 set_get_macro(bool, bce)
 set_get_macro(bool, bve_during_elimtofile)
 set_get_macro(bool, weighted)
 
 DLL_PUBLIC void Arjun::set_pred_forever_cutoff(int pred_forever_cutoff) {
+    arjdata->common.pred_forever_cutoff = pred_forever_cutoff;
+    arjdata->common.pred_forever_cutoff_set = true;
     arjdata->common.solver->set_pred_forever_cutoff(pred_forever_cutoff);
 }
 
 DLL_PUBLIC void Arjun::set_every_pred_reduce(int every_pred_reduce) {
+    arjdata->common.every_pred_reduce = every_pred_reduce;
+    arjdata->common.every_pred_reduce_set = true;
     arjdata->common.solver->set_every_pred_reduce(every_pred_reduce);
 }
 
@@ -315,7 +372,7 @@ bool Arjun::definitely_satisfiable() const {
 
 DLL_PUBLIC SimplifiedCNF Arjun::get_fully_simplified_renumbered_cnf(const SimpConf& simp_conf)
 {
-    Puura puura(arjdata->common.conf);
+    Puura puura(arjdata->common.conf, arjdata->common.phase_stats);
     return puura.get_fully_simplified_renumbered_cnf(this, simp_conf,
             arjdata->common.sampling_set,
             arjdata->common.set_sampling_vars,
@@ -323,6 +380,20 @@ DLL_PUBLIC SimplifiedCNF Arjun::get_fully_simplified_renumbered_cnf(const SimpCo
             arjdata->common.orig_sampling_vars);
 }
 
+DLL_PUBLIC void Arjun::stream_fully_simplified_renumbered_cnf(
+        const SimpConf& simp_conf,
+        SimplifiedCNFSink& sink,
+        const bool opt_sampl_is_all,
+        const bool red)
+{
+    Puura puura(arjdata->common.conf, arjdata->common.phase_stats);
+    puura.stream_fully_simplified_renumbered_cnf(this, simp_conf, sink,
+            opt_sampl_is_all, red,
+            arjdata->common.sampling_set,
+            arjdata->common.empty_sampling_vars,
+            arjdata->common.orig_sampling_vars);
+}
+
 DLL_PUBLIC void Arjun::set_lit_weight(
         [[maybe_unused]] const CMSat::Lit lit, [[maybe_unused]] const double weight) {
 #ifdef WEIGHTED
@@ -337,7 +408,7 @@ DLL_PUBLIC void Arjun::run_sbva(SimplifiedCNF& orig,
 {
     if (sbva_steps == 0) return;
 
-    Puura puura(arjdata->common.conf);
+    Puura puura(arjdata->common.conf, arjdata->common.phase_stats);
     puura.run_sbva(orig, sbva_steps, sbva_cls_cutoff, sbva_lits_cutoff, sbva_tiebreak);
 }
 
@@ -22,12 +22,16 @@ THE SOFTWARE.
 
 #pragma once
 
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
+#include <iterator>
 #include <vector>
 #include <utility>
 #include <string>
 #include <mpfr.h>
 #include <map>
+#include <thread>
 #include <gmpxx.h>
 #ifdef CMS_LOCAL_BUILD
 #include "cryptominisat.h"
@@ -48,12 +52,103 @@ namespace ArjunNS {
         int bve_too_large_resolvent = -1;
     };
 
+    // Read-only view of a clause inside a FlatClauses
+    class ClauseRef {
+    public:
+        ClauseRef(const CMSat::Lit* _b, const CMSat::Lit* _e) : b(_b), e(_e) {}
+        const CMSat::Lit* begin() const { return b; }
+        const CMSat::Lit* end() const { return e; }
+        size_t size() const { return e-b; }
+        bool empty() const { return b == e; }
+        const CMSat::Lit& operator[](const size_t i) const { return b[i]; }
+        // So it can be passed to add_clause() and friends
+        operator std::vector<CMSat::Lit>() const { return std::vector<CMSat::Lit>(b, e); }
+    private:
+        const CMSat::Lit* b;
+        const CMSat::Lit* e;
+    };
+
+    // Clauses back to back in one literal array, clause i being
+    // lits[offs[i]..offs[i+1]). Indexing and iterating yield ClauseRef-s.
+    //
+    // SimplifiedCNF::cnf and red_cnf used to be vector<vector<Lit>>. That code
+    // keeps compiling: FlatClauses is built from and converts back to one, and
+    // has push_back(), size(), empty(), clear() and range-for. What no longer
+    // works is changing a clause in place through a vector<Lit>&, and growing
+    // a clause after it was added. Use all_lits() for in-place renumbering, or
+    // to_vectors(), edit, then assign back.
+    class FlatClauses {
+    public:
+        class const_iterator {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = ClauseRef;
+            using difference_type = std::ptrdiff_t;
+            using pointer = void;
+            using reference = ClauseRef;
+            const_iterator(const FlatClauses* _c, size_t _at) : c(_c), at(_at) {}
+            ClauseRef operator*() const { return (*c)[at]; }
+            const_iterator& operator++() { at++; return *this; }
+            const_iterator operator++(int) { auto r = *this; at++; return r; }
+            bool operator==(const const_iterator& o) const { return at == o.at; }
+            bool operator!=(const const_iterator& o) const { return at != o.at; }
+        private:
+            const FlatClauses* c;
+            size_t at;
+        };
+
+        FlatClauses() = default;
+        FlatClauses(const std::vector<std::vector<CMSat::Lit>>& cls) {
+            reserve(cls.size(), 0);
+            for(const auto& cl: cls) push_back(cl);
+        }
+        std::vector<std::vector<CMSat::Lit>> to_vectors() const {
+            std::vector<std::vector<CMSat::Lit>> ret;
+            ret.reserve(size());
+            for(const auto& cl: *this) ret.emplace_back(cl.begin(), cl.end());
+            return ret;
+        }
+        operator std::vector<std::vector<CMSat::Lit>>() const { return to_vectors(); }
+
+        size_t size() const { return offs.size()-1; }
+        bool empty() const { return size() == 0; }
+        size_t num_lits() const { return lits.size(); }
+        void clear() {
+            lits.clear();
+            offs.resize(1);
+        }
+        void reserve(const size_t num_cls, const size_t num_lits) {
+            offs.reserve(num_cls+1);
+            lits.reserve(num_lits);
+        }
+        template<class C> void push_back(const C& cl) {
+            lits.insert(lits.end(), cl.begin(), cl.end());
+            offs.push_back(lits.size());
+        }
+        // Builds a clause in place, without a temporary vector
+        void push_lit(const CMSat::Lit l) { lits.push_back(l); }
+        void finish_clause() { offs.push_back(lits.size()); }
+        size_t unfinished_lits() const { return lits.size() - offs.back(); }
+        ClauseRef operator[](const size_t i) const {
+            return ClauseRef(lits.data() + offs[i], lits.data() + offs[i+1]);
+        }
+        ClauseRef back() const { return (*this)[size()-1]; }
+        const_iterator begin() const { return const_iterator(this, 0); }
+        const_iterator end() const { return const_iterator(this, size()); }
+        // All literals, in order, e.g. to renumber them in place
+        std::vector<CMSat::Lit>& all_lits() { return lits; }
+
+    private:
+        std::vector<CMSat::Lit> lits;
+        std::vector<uint64_t> offs = std::vector<uint64_t>(1, 0);
+    };
+
     struct SimplifiedCNF {
         uint32_t nvars = 0;
         std::vector<uint32_t> sampl_vars;
         std::vector<uint32_t> opt_sampl_vars;
-        std::vector<std::vector<CMSat::Lit>> cnf;
-        std::vector<std::vector<CMSat::Lit>> red_cnf;
+        FlatClauses cnf;
+        FlatClauses red_cnf;
 
         bool weighted = false;
         mpz_class multiplier_weight = 1;
@@ -61,17 +156,32 @@ namespace ArjunNS {
         std::map<CMSat::Lit, double> weights; // ONLY makes sense when weighted is TRUE
 #endif
 
-        std::vector<CMSat::Lit>& map_cl(std::vector<CMSat::Lit>& cl, std::vector<uint32_t> v_map) {
+        // Empty, but the vectors keep their allocated space
+        void clear() {
+            nvars = 0;
+            sampl_vars.clear();
+            opt_sampl_vars.clear();
+            cnf.clear();
+            red_cnf.clear();
+            weighted = false;
+            multiplier_weight = 1;
+#ifdef WEIGHTED
+            weights.clear();
+#endif
+        }
+
+        std::vector<CMSat::Lit>& map_cl(std::vector<CMSat::Lit>& cl, const std::vector<uint32_t>& v_map) {
             for(auto& l: cl) l = CMSat::Lit(v_map[l.var()], l.sign());
             return cl;
         }
-        std::vector<uint32_t>& map_var(std::vector<uint32_t>& cl, std::vector<uint32_t> v_map) {
+        std::vector<uint32_t>& map_var(std::vector<uint32_t>& cl, const std::vector<uint32_t>& v_map) {
             for(auto& l: cl) l = v_map[l];
             return cl;
         }
 
-        // renumber variables such that sampling set start from 0...N
-        void renumber_sampling_vars_for_ganak() {
+        // Map such that sampling set starts from 0...N, then the optional
+        // sampling set, then the rest. Needs no clauses.
+        std::vector<uint32_t> ganak_var_map() const {
             assert(sampl_vars.size() <= opt_sampl_vars.size());
             constexpr uint32_t m = std::numeric_limits<uint32_t>::max();
             std::vector<uint32_t> map_here_to_there(nvars, m);
@@ -98,21 +208,88 @@ namespace ArjunNS {
                 }
             }
             assert(i == nvars);
+            return map_here_to_there;
+        }
 
-            // Now we renumber
+        // Renumbers everything but the clauses
+        void renumber_meta(const std::vector<uint32_t>& map_here_to_there) {
             sampl_vars = map_var(sampl_vars, map_here_to_there);
             opt_sampl_vars = map_var(opt_sampl_vars, map_here_to_there);
-            for(auto& cl: cnf) map_cl(cl, map_here_to_there);
-            for(auto& cl: red_cnf) map_cl(cl, map_here_to_there);
 #ifdef WEIGHTED
             if (weighted) {
-                std::map<CMSat::Lit, double> new_weights;
-                for(auto& w: weights)
-                    new_weights[CMSat::Lit(map_here_to_there[w.first.var()], w.first.sign())] = w.second;
-                weights = new_weights;
+                // Re-key the existing nodes instead of building a new map.
+                // All are taken out first, so new keys can't clash with old ones.
+                std::vector<std::map<CMSat::Lit, double>::node_type> nodes;
+                nodes.reserve(weights.size());
+                while(!weights.empty()) nodes.push_back(weights.extract(weights.begin()));
+                for(auto& n: nodes) {
+                    n.key() = CMSat::Lit(map_here_to_there[n.key().var()], n.key().sign());
+                    weights.insert(std::move(n));
+                }
             }
 #endif
         }
+
+        // renumber variables such that sampling set start from 0...N
+        // The clause literals are split into ranges, one per thread, all
+        // reading the same map.
+        void renumber_sampling_vars_for_ganak(uint32_t num_threads = 1) {
+            const auto map_here_to_there = ganak_var_map();
+            renumber_meta(map_here_to_there);
+            map_lits_par(cnf.all_lits(), map_here_to_there, num_threads);
+            map_lits_par(red_cnf.all_lits(), map_here_to_there, num_threads);
+        }
+
+        // Literals each thread gets at least. Starting and joining a thread
+        // costs about as much as mapping 3000 literals, so this keeps that
+        // near 1% of a thread's work. Measured with tests/renumber_bench.cpp
+        static constexpr size_t map_lits_min_per_thread = 1ULL << 18;
+
+        // Maps the literals in place, split into ranges, one per thread
+        static void map_lits_par(std::vector<CMSat::Lit>& lits,
+                const std::vector<uint32_t>& v_map, uint32_t num_threads,
+                const size_t min_per_thread = map_lits_min_per_thread) {
+            auto map_range = [&](size_t from, size_t to) {
+                for(size_t i = from; i < to; i++)
+                    lits[i] = CMSat::Lit(v_map[lits[i].var()], lits[i].sign());
+            };
+            const size_t n = std::max<size_t>(1,
+                std::min<size_t>(num_threads, lits.size()/std::max<size_t>(1, min_per_thread)));
+            if (n == 1) {
+                map_range(0, lits.size());
+                return;
+            }
+            std::vector<std::thread> ts;
+            ts.reserve(n-1);
+            const size_t chunk = (lits.size()+n-1)/n;
+            for(size_t t = 1; t < n; t++)
+                ts.emplace_back(map_range, t*chunk, std::min(lits.size(), (t+1)*chunk));
+            map_range(0, chunk);
+            for(auto& t: ts) t.join();
+        }
+    };
+
+    // One phase of the run (probing, gates, backward, ...), see Arjun::get_stats()
+    struct PhaseStats {
+        std::string name;
+        double wall_time = 0; // seconds
+        double cpu_time = 0; // seconds, all threads of the process
+        uint64_t peak_rss = 0; // bytes, largest RSS seen at start or end of phase
+        std::vector<std::pair<std::string, uint64_t>> counts;
+    };
+
+    // Receives a simplified CNF without it ever being held in memory whole
+    struct SimplifiedCNFSink {
+        virtual ~SimplifiedCNFSink() = default;
+        // If true, header() gets the clause counts, which costs an extra pass
+        // over the clauses of the solver. Otherwise they are 0 there, and the
+        // sink must fill them in at done()
+        virtual bool counts_first() const { return true; }
+        // Called first. `meta` is everything but the clauses, already renumbered
+        virtual void header(const SimplifiedCNF& meta, uint64_t num_cls, uint64_t num_red) = 0;
+        virtual void clause(const std::vector<CMSat::Lit>& cl, bool red) = 0;
+        // Called last, with the number of clauses given
+        virtual void done(uint64_t /*num_cls*/, uint64_t /*num_red*/) {}
     };
 
     struct ArjPrivateData;
@@ -125,6 +302,12 @@ namespace ArjunNS {
     public:
         Arjun();
         ~Arjun();
+        // Drops the formula and all results, so the object can take a new
+        // formula. Everything set through the setters is kept, options turned
+        // off for the last formula only are turned back on, and the random
+        // source is re-seeded, so a run gives the same as on a new object.
+        // Internal buffers keep their allocated space.
+        void reset();
         static std::string get_version_info();
         static std::string get_sbva_version_info();
         static std::string get_compilation_env();
@@ -136,6 +319,9 @@ namespace ArjunNS {
         bool add_xor_clause(const std::vector<CMSat::Lit>& lits, bool rhs);
         bool add_xor_clause(const std::vector<uint32_t>& vars, bool rhs);
         void set_lit_weight(const CMSat::Lit lit, const double weight);
+        // Can also be called after run_backwards(), as long as no new
+        // variables are used. The next run_backwards() call then only
+        // re-checks the current independent set.
         bool add_clause(const std::vector<CMSat::Lit>& lits);
         bool add_red_clause(const std::vector<CMSat::Lit>& lits);
         bool add_bnn_clause(
@@ -171,9 +357,20 @@ namespace ArjunNS {
         void end_getting_constraints();
         SimplifiedCNF get_fully_simplified_renumbered_cnf(
                 const SimpConf& simp_conf);
+        // Same simplification, followed by renumber_sampling_vars_for_ganak(),
+        // but each clause is renumbered and handed to `sink` as it is read out
+        // of the solver. The optional sampling set is either all variables or
+        // the sampling set. No SBVA is run.
+        void stream_fully_simplified_renumbered_cnf(
+                const SimpConf& simp_conf,
+                SimplifiedCNFSink& sink,
+                const bool opt_sampl_is_all,
+                const bool red = true);
         std::vector<CMSat::Lit> get_zero_assigned_lits() const;
         std::vector<std::pair<CMSat::Lit, CMSat::Lit> > get_all_binary_xors() const;
         const SimplifiedCNF& get_orig_cnf() const;
+        // Phases run so far, in the order they finished
+        const std::vector<PhaseStats>& get_stats() const;
         void run_sbva(SimplifiedCNF& orig,
             int64_t sbva_steps = 200, uint32_t sbva_cls_cutoff = 2,
             uint32_t sbva_lits_cutoff = 2, int sbva_tiebreak = 1);
@@ -193,6 +390,13 @@ namespace ArjunNS {
         void set_probe_based(bool probe_based);
         void set_backward(bool backward);
         void set_backw_max_confl(uint32_t backw_max_confl);
+        void set_backw_confl_start(uint32_t backw_confl_start);
+        void set_backw_confl_mult(double backw_confl_mult);
+        void set_backw_max_time(double backw_max_time);
+        void set_num_threads(uint32_t num_threads);
+        void set_backw_group_max(uint32_t backw_group_max);
+        void set_portfolio(uint32_t portfolio);
+        void set_portfolio_time(double portfolio_time);
         void set_gauss_jordan(bool gauss_jordan);
         void set_find_xors(bool find_xors);
         void set_ite_gate_based(bool ite_gate_based);
@@ -203,6 +407,12 @@ namespace ArjunNS {
         void set_pred_forever_cutoff(int pred_forever_cutoff = -1);
         void set_every_pred_reduce(int every_pred_reduce = -1);
         void set_specified_order_fname(std::string specified_order_fname);
+        void set_checkpoint_fname(std::string checkpoint_fname);
+        void set_checkpoint_every(double checkpoint_every);
+        void set_resume_fname(std::string resume_fname);
+        void set_status_fname(std::string status_fname);
+        void set_status_every(double status_every);
+        void set_gate_cache_dir(std::string gate_cache_dir);
         void set_bce(const bool bce);
         void set_bve_during_elimtofile(const bool);
         void set_weighted(const bool);
@@ -210,6 +420,12 @@ namespace ArjunNS {
 
         //Get config
         std::string get_specified_order_fname() const;
+        std::string get_checkpoint_fname() const;
+        double get_checkpoint_every() const;
+        std::string get_resume_fname() const;
+        std::string get_status_fname() const;
+        double get_status_every() const;
+        std::string get_gate_cache_dir() const;
         double get_no_gates_below() const;
         bool get_simp() const;
         uint32_t get_verbosity() const;
@@ -224,6 +440,13 @@ namespace ArjunNS {
         bool get_probe_based() const;
         bool get_backward() const;
         uint32_t get_backw_max_confl() const;
+        uint32_t get_backw_confl_start() const;
+        double get_backw_confl_mult() const;
+        double get_backw_max_time() const;
+        uint32_t get_num_threads() const;
+        uint32_t get_backw_group_max() const;
+        uint32_t get_portfolio() const;
+        double get_portfolio_time() const;
         bool get_gauss_jordan() const;
         bool get_find_xors() const;
         bool get_ite_gate_based() const;
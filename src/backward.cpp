@@ -24,6 +24,12 @@
 
 #include "common.h"
 #include <set>
+#include <cstdio>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 
 using namespace ArjunInt;
 
@@ -40,8 +46,7 @@ void Common::fill_assumptions_backward(
     for(const auto& var: indep) {
         assert(var < orig_num_vars);
 
-        uint32_t indic = var_to_indic[var];
-        assert(indic != var_Undef);
+        uint32_t indic = get_indic(var);
         assumptions.push_back(Lit(indic, false));
         verb_print(5, "Filled assump with indep: " << var);
     }
@@ -55,14 +60,24 @@ void Common::fill_assumptions_backward(
         verb_print(5, "Filled assump with unknown: " << var);
 
         assert(var < orig_num_vars);
-        uint32_t indic = var_to_indic[var];
-        assert(indic != var_Undef);
+        uint32_t indic = get_indic(var);
         assumptions.push_back(Lit(indic, false));
     }
     unknown.resize(j);
     verb_print(5, "Filling assumps END, total assumps size: " << assumptions.size());
 }
 
+// Brings `as` in line with indep+unknown after arbitrary changes to them
+void Common::sync_assumptions_backward(
+    AssumpStack& as,
+    vector<uint32_t>& unknown,
+    const vector<char>& unknown_set,
+    const vector<uint32_t>& indep)
+{
+    fill_assumptions_backward(as.lits, unknown, unknown_set, indep);
+    as.num_indep = indep.size();
+}
+
 void Common::order_by_file(const string& fname, vector<uint32_t>& unknown) {
     std::set<uint32_t> old_unknown(unknown.begin(), unknown.end());
     unknown.clear();
@@ -100,7 +115,204 @@ void Common::print_sorted_unknown(const vector<uint32_t>& unknown) const
     }
 }
 
+// Checkpoint of the backward round. Variables start at ZERO. The state before
+// the backward round is not stored, as it's recomputed deterministically.
+// Written to a temporary file first and then renamed, so a kill during
+// writing leaves the previous checkpoint intact. Failing to write it is not
+// fatal, the round goes on and tries again at the next checkpoint.
+void Common::write_backw_checkpoint(
+    const vector<uint32_t>& order,
+    const vector<char>& unknown_set,
+    const vector<uint32_t>& indep,
+    const uint32_t iter,
+    const uint32_t not_indep)
+{
+    double my_time = cpuTime();
+    const string tmp_fname = conf.checkpoint_fname + ".tmp";
+    std::ofstream outf(tmp_fname.c_str(), std::ios::out);
+    if (!outf) {
+        cout << "c WARNING: cannot open checkpoint file '" << tmp_fname << "' for writing" << endl;
+        return;
+    }
+
+    for(const auto& v: indep) seen[v] = 1;
+    vector<uint32_t> unknown;
+    vector<uint32_t> removed;
+    for(const auto& v: order) {
+        if (unknown_set[v]) unknown.push_back(v);
+        else if (!seen[v]) removed.push_back(v);
+    }
+    for(const auto& v: indep) seen[v] = 0;
+
+    auto write_vars = [&](const char* name, const vector<uint32_t>& vars) {
+        outf << name << " " << vars.size();
+        for(const auto& v: vars) outf << " " << v;
+        outf << "\n";
+    };
+    outf << "c arjun backward checkpoint\n";
+    outf << "version 2\n";
+    outf << "key " << backw_checkpoint_key(order) << "\n";
+    outf << "iter " << iter << "\n";
+    outf << "notindep " << not_indep << "\n";
+    write_vars("order", order);
+    write_vars("indep", indep);
+    write_vars("unknown", unknown);
+    write_vars("removed", removed);
+    outf.close();
+    if (!outf || std::rename(tmp_fname.c_str(), conf.checkpoint_fname.c_str()) != 0) {
+        cout << "c WARNING: could not write checkpoint file '" << conf.checkpoint_fname << "'" << endl;
+        std::remove(tmp_fname.c_str());
+        return;
+    }
+    verb_print(1, "[arjun] checkpoint written to '" << conf.checkpoint_fname << "'"
+        << " I: " << indep.size() << " U: " << unknown.size() << " N: " << removed.size()
+        << " T: " << std::setprecision(2) << std::fixed << (cpuTime() - my_time));
+}
+
+// What a checkpoint is only valid for: the input formula, the sampling set
+// the round started with and the config it was computed with. The removed
+// vars of a checkpoint are only known to be defined in the same context.
+string Common::backw_checkpoint_key(const vector<uint32_t>& order) const
+{
+    const Config& c = user_conf;
+    return formula_hash(order, {(uint64_t)c.seed, (uint64_t)c.simp,
+        (uint64_t)c.probe_based, (uint64_t)c.xor_gates_based, (uint64_t)c.or_gate_based,
+        (uint64_t)c.ite_gate_based, (uint64_t)c.irreg_gate_based,
+        (uint64_t)c.bve_pre_simplify, (uint64_t)c.gauss_jordan, (uint64_t)c.bce,
+        (uint64_t)c.incidence_count, (uint64_t)c.unknown_sort});
+}
+
+// Restores the state written by write_backw_checkpoint(). `unknown` and
+// `unknown_set` must hold the freshly sorted sampling set. The checkpoint is
+// refused unless it was written for the same formula, sampling set and
+// config. It's only read once, so a later backward round (e.g. after adding
+// clauses, or on the next formula after reset()) starts from scratch.
+void Common::read_backw_checkpoint(
+    vector<uint32_t>& unknown,
+    vector<char>& unknown_set,
+    vector<uint32_t>& indep,
+    uint32_t& iter,
+    uint32_t& not_indep)
+{
+    const string fname = conf.resume_fname;
+    conf.resume_fname.clear();
+    user_conf.resume_fname.clear();
+    std::ifstream infile(fname);
+    if (!infile) {
+        cout << "ERROR: cannot open checkpoint file '" << fname << "' for reading" << endl;
+        exit(-1);
+    }
+    auto bad_file = [&](const string& what) {
+        cout << "ERROR: checkpoint file '" << fname << "' is corrupt: " << what << endl;
+        exit(-1);
+    };
+    auto read_vars = [&](const char* name, vector<uint32_t>& vars) {
+        string tag;
+        size_t num;
+        if (!(infile >> tag) || tag != name || !(infile >> num)) bad_file(string("expected ") + name);
+        vars.resize(num);
+        for(auto& v: vars) {
+            if (!(infile >> v)) bad_file(string("bad variable in ") + name);
+        }
+    };
+
+    string line;
+    std::getline(infile, line);
+    if (line != "c arjun backward checkpoint") bad_file("wrong header");
+    string tag;
+    uint32_t version;
+    if (!(infile >> tag >> version) || tag != "version" || version != 2) bad_file("wrong version");
+    string key;
+    if (!(infile >> tag >> key) || tag != "key") bad_file("expected key");
+    if (key != backw_checkpoint_key(unknown)) {
+        cout << "ERROR: checkpoint file '" << fname << "' was written for a different"
+            << " formula, sampling set or configuration" << endl;
+        exit(-1);
+    }
+    if (!(infile >> tag >> iter) || tag != "iter") bad_file("expected iter");
+    if (!(infile >> tag >> not_indep) || tag != "notindep") bad_file("expected notindep");
+    vector<uint32_t> order, saved_indep, saved_unknown, removed;
+    read_vars("order", order);
+    read_vars("indep", saved_indep);
+    read_vars("unknown", saved_unknown);
+    read_vars("removed", removed);
+
+    // seen: 1 == in current sampling set, 2 == also in checkpoint
+    for(const auto& v: unknown) seen[v] = 1;
+    auto in_current = [&](const uint32_t v) { return v < orig_num_vars && seen[v] != 0; };
+    uint32_t missing = 0;
+    vector<uint32_t> new_unknown;
+    for(const auto& v: order) {
+        if (!in_current(v)) {
+            missing++;
+            continue;
+        }
+        if (seen[v] == 2) bad_file("variable twice in order");
+        seen[v] = 2;
+        new_unknown.push_back(v);
+    }
+    // Not in the checkpoint, these will be tested last
+    vector<uint32_t> extra;
+    for(const auto& v: unknown) if (seen[v] == 1) extra.push_back(v);
+    new_unknown.insert(new_unknown.begin(), extra.begin(), extra.end());
+
+    indep.clear();
+    for(const auto& v: saved_indep) if (in_current(v)) {
+        indep.push_back(v);
+        unknown_set[v] = 0;
+    }
+    for(const auto& v: removed) if (in_current(v)) unknown_set[v] = 0;
+    for(const auto& v: unknown) seen[v] = 0;
+    unknown = new_unknown;
+    uint32_t num_unknown = 0;
+    for(const auto& v: unknown) num_unknown += unknown_set[v];
+
+    verb_print(1, "[arjun] resumed from checkpoint '" << fname << "'"
+        << " I: " << indep.size() << " U: " << num_unknown
+        << " N: " << removed.size() << " iter: " << iter
+        << " vars not in sampling set: " << missing
+        << " vars not in checkpoint: " << extra.size());
+}
+
+uint32_t Common::initial_backw_budget() const
+{
+    if (conf.backw_confl_start == 0) return conf.backw_max_confl;
+    return std::min(conf.backw_confl_start, conf.backw_max_confl);
+}
+
+// Geometrically increases `max_confl` for the next pass over the variables
+// that timed out. Returns false if there is no conflict or time budget left.
+bool Common::escalate_backw_budget(uint32_t& max_confl, const double start_time) const
+{
+    if (max_confl >= conf.backw_max_confl) return false;
+    if (conf.backw_max_time > 0 && cpuTimeTotal() - start_time > conf.backw_max_time) {
+        verb_print(1, "[arjun] time budget used up, not retrying timed out vars");
+        return false;
+    }
+    uint64_t next = (uint64_t)((double)max_confl * conf.backw_confl_mult);
+    next = std::max<uint64_t>(next, (uint64_t)max_confl+1);
+    max_confl = std::min<uint64_t>(next, conf.backw_max_confl);
+    return true;
+}
+
 void Common::backward_round() {
+    if ((conf.portfolio > 1 || conf.num_threads > 1)
+            && (!conf.checkpoint_fname.empty() || !conf.resume_fname.empty())) {
+        cout << "c WARNING: checkpoint and resume files are ignored with more than one"
+            " thread or a portfolio" << endl;
+    }
+    if (conf.portfolio > 1) {
+        backward_round_portfolio();
+        return;
+    }
+    if (conf.num_threads > 1) {
+        backward_round_par();
+        return;
+    }
+    if (conf.backw_group_max > 1) {
+        backward_round_group();
+        return;
+    }
     for(const auto& x: seen) assert(x == 0);
     double start_round_time = cpuTimeTotal();
     //start with empty independent set
@@ -118,12 +330,19 @@ void Common::backward_round() {
     }
     sort_unknown(unknown);
     if (!conf.specified_order_fname.empty()) order_by_file(conf.specified_order_fname, unknown);
+    uint32_t iter = 0;
+    uint32_t not_indep = 0;
+    if (!conf.resume_fname.empty())
+        read_backw_checkpoint(unknown, unknown_set, indep, iter, not_indep);
+    const vector<uint32_t> order = unknown;
+    double last_checkpoint = real_time_sec();
     print_sorted_unknown(unknown);
     verb_print(1, "[arjun] Start unknown size: " << unknown.size());
 
+    // Suffix of as.lits mirrors `unknown`, the top of the stack is tested next.
+    // Filled right before the first query, that's when the indicators are made
+    AssumpStack as;
     vector<Lit> assumptions;
-    uint32_t iter = 0;
-    uint32_t not_indep = 0;
     double my_time = cpuTime();
 
     //Calc mod:
@@ -139,79 +358,81 @@ void Common::backward_round() {
     uint32_t ret_false = 0;
     uint32_t ret_true = 0;
     uint32_t ret_undef = 0;
-    bool quick_pop_ok = false;
     uint32_t fast_backw_calls = 0;
     uint32_t fast_backw_max = 0;
     uint32_t fast_backw_tot = 0;
     uint32_t indic_var = var_Undef;
     vector<uint32_t> non_indep_vars;
+    uint32_t max_confl = initial_backw_budget();
+    vector<uint32_t> retry; // timed out with max_confl, in order of testing
+    RoundStatus status("backward", unknown.size());
+    const uint64_t start_confl = solver->get_sum_conflicts();
+    auto update_status = [&]() {
+        status.set(iter, unknown.size(), indep.size(), not_indep);
+        status.conflicts = solver->get_sum_conflicts() - start_confl;
+    };
     while(true) {
         uint32_t test_var = var_Undef;
-        if (quick_pop_ok) {
-            //Remove 2 last
-            assumptions.pop_back();
-            assumptions.pop_back();
-
-            //No more left, try again with full
-            if (assumptions.empty()) {
-                verb_print(5, "[arjun] No more left, try again with full");
-                break;
-            }
-
-            indic_var = assumptions[assumptions.size()-1].var();
-            assumptions.pop_back();
-            assert(indic_var < indic_to_var.size());
-            test_var = indic_to_var[indic_var];
-            assert(test_var != var_Undef);
-            assert(test_var < orig_num_vars);
+        if (as.lits.empty() && !unknown.empty())
+            sync_assumptions_backward(as, unknown, unknown_set, indep);
+        if (!unknown.empty()) {
+            test_var = unknown.back();
+            unknown.pop_back();
+            assert(unknown_set[test_var]);
+            assert(as.lits.back() == Lit(var_to_indic[test_var], false));
+            as.lits.pop_back();
+        }
 
-            //something is messed up
-            if (!unknown_set[test_var]) {
-                quick_pop_ok = false;
-                continue;
+        if (test_var == var_Undef && !retry.empty() &&
+                escalate_backw_budget(max_confl, start_round_time)) {
+            // Timed out vars were kept as independent, test them again
+            for(const auto& v: retry) seen[v] = 1;
+            uint32_t j = 0;
+            for(uint32_t i = 0; i < indep.size(); i++) {
+                if (!seen[indep[i]]) indep[j++] = indep[i];
             }
-            uint32_t last_unkn = unknown[unknown.size()-1];
-            assert(last_unkn == test_var);
-            unknown.pop_back();
-        } else {
-            while(!unknown.empty()) {
-                uint32_t var = unknown[unknown.size()-1];
-                if (unknown_set[var]) {
-                    test_var = var;
-                    unknown.pop_back();
-                    break;
-                } else {
-                    unknown.pop_back();
-                }
+            indep.resize(j);
+            for(const auto& v: retry) seen[v] = 0;
+            for(auto it = retry.rbegin(); it != retry.rend(); it++) {
+                unknown.push_back(*it);
+                unknown_set[*it] = 1;
             }
+            verb_print(1, "[arjun] re-testing " << retry.size()
+                << " timed out vars with max confl: " << max_confl);
+            retry.clear();
+            sync_assumptions_backward(as, unknown, unknown_set, indep);
+            continue;
+        }
 
-            if (test_var == var_Undef) {
-                //we are done, backward is finished
-                verb_print(5, "[arjun] we are done, backward is finished");
-                break;
-            }
-            indic_var = var_to_indic[test_var];
+        if (test_var == var_Undef) {
+            //we are done, backward is finished
+            verb_print(5, "[arjun] we are done, backward is finished");
+            break;
         }
+        indic_var = get_indic(test_var);
         assert(test_var < orig_num_vars);
         assert(unknown_set[test_var] == 1);
         unknown_set[test_var] = 0;
 //         cout << "Testing: " << test_var << endl;
 
-        //Assumption filling
         assert(test_var != var_Undef);
-        if (!quick_pop_ok) {
-            fill_assumptions_backward(assumptions, unknown, unknown_set, indep);
-        }
-        assumptions.push_back(Lit(test_var, false));
-        assumptions.push_back(Lit(test_var + orig_num_vars, true));
+        as.lits.push_back(Lit(test_var, false));
+        as.lits.push_back(Lit(test_var + orig_num_vars, true));
 
         solver->set_no_confl_needed();
 
         lbool ret = l_Undef;
+        // Fast backward may decide about other vars too, then we re-sync
+        bool need_sync = false;
         if (!conf.fast_backw) {
-            solver->set_max_confl(conf.backw_max_confl);
-            ret = solver->solve(&assumptions);
+            solver->set_max_confl(max_confl);
+            ret = solver->solve(&as.lits);
+            as.pop_test(2);
         } else {
+            // find_fast_backw() changes the assumptions, give it a copy
+            assumptions = as.lits;
+            as.pop_test(2);
+            const uint32_t orig_test_var = test_var;
             FastBackwData b;
             b._assumptions = &assumptions;
             b.indic_to_var  = &indic_to_var;
@@ -221,7 +442,7 @@ void Common::backward_round() {
             b.fast_backw_on = true;
             b.test_indic = &indic_var;
             b.test_var = &test_var;
-            b.max_confl = conf.backw_max_confl;
+            b.max_confl = max_confl;
 
             fast_backw_calls++;
             if (conf.verb > 5) {
@@ -239,12 +460,13 @@ void Common::backward_round() {
                 for(auto& x: unknown_set) x = 0;
                 unknown.clear();
                 indep.clear();
-                assumptions.clear();
+                as.clear();
                 break;
             }
 
             fast_backw_tot += non_indep_vars.size();
             fast_backw_max = std::max<uint32_t>(non_indep_vars.size(), fast_backw_max);
+            status.add_fast_backw(non_indep_vars.size());
             for(uint32_t i = indep_vars_last_pos; i < indep.size(); i ++) {
                 uint32_t var = indep[i];
                 unknown_set[var] = 0;
@@ -255,15 +477,19 @@ void Common::backward_round() {
                 unknown_set[var] = 0;
                 not_indep++;
             }
-            quick_pop_ok = false;
+            need_sync = !non_indep_vars.empty()
+                || indep.size() != indep_vars_last_pos
+                || test_var != orig_test_var;
 
             //We have finished it all off
             if (test_var == var_Undef) {
                 assert(indic_var == var_Undef);
+                sync_assumptions_backward(as, unknown, unknown_set, indep);
                 continue;
             }
             unknown_set[test_var] = 0;
         }
+        status.add_ret(ret);
         if (ret == l_False) {
             ret_false++;
             verb_print(5, "[arjun] backw solve(): False");
@@ -278,19 +504,20 @@ void Common::backward_round() {
         assert(unknown_set[test_var] == 0);
         if (ret == l_Undef) {
             //Timed out, we'll treat is as unknown
-            quick_pop_ok = false;
             assert(test_var < orig_num_vars);
             indep.push_back(test_var);
+            if (!need_sync) as.add_indep(Lit(get_indic(test_var), false));
+            if (max_confl < conf.backw_max_confl) retry.push_back(test_var);
         } else if (ret == l_True) {
             //Independent
-            quick_pop_ok = false;
             indep.push_back(test_var);
+            if (!need_sync) as.add_indep(Lit(get_indic(test_var), false));
         } else if (ret == l_False) {
             //not independent
             //i.e. given that all in indep+unkown is equivalent, it's not possible that a1 != b1
             not_indep++;
-            quick_pop_ok = true;
         }
+        if (need_sync) sync_assumptions_backward(as, unknown, unknown_set, indep);
 
         if (iter % mod == (mod-1) && conf.verb) {
             //solver->remove_and_clean_all();
@@ -333,11 +560,649 @@ void Common::backward_round() {
         if (iter % 500 == 499) {
             update_sampling_set(unknown, unknown_set, indep);
         }
+        if (!conf.checkpoint_fname.empty() &&
+                real_time_sec() - last_checkpoint > conf.checkpoint_every) {
+            write_backw_checkpoint(order, unknown_set, indep, iter, not_indep);
+            last_checkpoint = real_time_sec();
+        }
+        if (status_due(status)) {
+            update_status();
+            write_status(status);
+        }
     }
     update_sampling_set(unknown, unknown_set, indep);
+    if (!conf.checkpoint_fname.empty())
+        write_backw_checkpoint(order, unknown_set, indep, iter, not_indep);
+    update_status();
+    write_status(status, true);
 
     verb_print(1, "[arjun] backward round finished. U: " <<
-            " I: " << sampling_set.size() << " T: "
+            " I: " << sampling_set.size() << " indicators: " << num_indics << " T: "
         << std::setprecision(2) << std::fixed << (cpuTime() - start_round_time));
     if (conf.verb >= 2) solver->print_stats();
 }
+
+enum class BackwSt : char {none, unknown, testing, indep, not_indep};
+
+// State shared between the backward worker threads, protected by `mu`
+struct BackwParState {
+    std::mutex mu;
+    std::condition_variable cv;
+    vector<uint32_t> order; // sorted sampling set, fixed after setup
+    vector<uint32_t> unknown; // stack of vars still to test
+    vector<BackwSt> st;
+    vector<uint32_t> indep; // only appended to
+    vector<uint32_t> removed; // only appended to
+    uint32_t in_flight = 0;
+    uint32_t not_indep = 0;
+    uint32_t retried = 0;
+    uint32_t iter = 0;
+    uint32_t ret_false = 0;
+    uint32_t ret_true = 0;
+    uint32_t ret_undef = 0;
+    std::mutex status_mu; // so only one thread writes the status file
+};
+
+// Each worker owns a copy of the duplicated formula and tests one variable
+// at a time. Variables being tested by other workers are still part of the
+// assumptions. A variable is only removed if its final conflict contains no
+// variable that got removed while it was being tested, so the order of
+// removals is a valid sequential order of the backward algorithm.
+// Otherwise it's put back into the unknown set and re-tested.
+// Workers only copy the indep/removed vars appended since their last query
+// while holding the lock, and build their assumptions outside of it.
+void Common::backward_round_par()
+{
+    for(const auto& x: seen) assert(x == 0);
+    double start_round_time = cpuTimeTotal();
+    // Workers share var_to_indic read-only, and need the clauses. The first
+    // queries hold every var of the set, so creating them later saves nothing.
+    add_all_indics(sampling_set);
+    const auto cnf = get_init_cnf();
+
+    BackwParState sh;
+    sh.st.resize(orig_num_vars, BackwSt::none);
+    for(const auto& x: sampling_set) {
+        assert(x < orig_num_vars);
+        assert(sh.st[x] == BackwSt::none && "No var should be in 'sampling_set' twice!");
+        sh.order.push_back(x);
+        sh.st[x] = BackwSt::unknown;
+    }
+    sort_unknown(sh.order);
+    if (!conf.specified_order_fname.empty()) order_by_file(conf.specified_order_fname, sh.order);
+    print_sorted_unknown(sh.order);
+    sh.unknown = sh.order;
+    verb_print(1, "[arjun] Start unknown size: " << sh.unknown.size()
+        << " threads: " << conf.num_threads);
+
+    uint32_t mod = 1;
+    if ((sampling_set.size()) > 20 ) {
+        uint32_t will_do_iters = sampling_set.size();
+        uint32_t want_printed = 30;
+        mod = will_do_iters/want_printed;
+        mod = std::max<int>(mod, 1);
+    }
+    double my_time = cpuTimeTotal();
+    RoundStatus status("backward", sh.unknown.size());
+
+    auto worker = [&]() {
+        SATSolver* s = new_solver_copy(cnf);
+        vector<Lit> assumptions;
+        uint64_t last_confl = 0;
+        // This worker's view of the shared state, as of its last query
+        vector<char> my_gone(orig_num_vars, 0); // indep or removed
+        vector<uint32_t> my_indep;
+        vector<uint32_t> new_removed;
+        size_t removed_at = 0;
+        std::unique_lock<std::mutex> lk(sh.mu);
+        while(true) {
+            uint32_t test_var = var_Undef;
+            while(!sh.unknown.empty()) {
+                uint32_t var = sh.unknown.back();
+                sh.unknown.pop_back();
+                if (sh.st[var] == BackwSt::unknown) {
+                    test_var = var;
+                    break;
+                }
+            }
+            if (test_var == var_Undef) {
+                // Someone may still put a var back for re-testing
+                if (sh.in_flight == 0) break;
+                sh.cv.wait(lk);
+                continue;
+            }
+            sh.st[test_var] = BackwSt::testing;
+            sh.in_flight++;
+            const size_t indep_at = my_indep.size();
+            my_indep.insert(my_indep.end(), sh.indep.begin() + indep_at, sh.indep.end());
+            new_removed.assign(sh.removed.begin() + removed_at, sh.removed.end());
+            removed_at = sh.removed.size();
+            lk.unlock();
+
+            for(size_t i = indep_at; i < my_indep.size(); i++) my_gone[my_indep[i]] = 1;
+            for(const auto& var: new_removed) my_gone[var] = 1;
+            assumptions.clear();
+            for(const auto& var: my_indep) assumptions.push_back(Lit(var_to_indic[var], false));
+            for(const auto& var: sh.order) {
+                if (var == test_var || my_gone[var]) continue;
+                assert(var_to_indic[var] != var_Undef);
+                assumptions.push_back(Lit(var_to_indic[var], false));
+            }
+
+            assumptions.push_back(Lit(test_var, false));
+            assumptions.push_back(Lit(test_var + orig_num_vars, true));
+            s->set_max_confl(conf.backw_max_confl);
+            const lbool ret = s->solve(&assumptions);
+
+            lk.lock();
+            sh.in_flight--;
+            status.add_ret(ret);
+            status.conflicts += s->get_sum_conflicts() - last_confl;
+            last_confl = s->get_sum_conflicts();
+            if (ret == l_False) {
+                bool ok = true;
+                for(const auto& l: s->get_conflict()) {
+                    if (l.var() >= indic_to_var.size()) continue;
+                    const uint32_t var = indic_to_var[l.var()];
+                    if (var != var_Undef && sh.st[var] == BackwSt::not_indep) {
+                        ok = false;
+                        break;
+                    }
+                }
+                if (ok) {
+                    sh.st[test_var] = BackwSt::not_indep;
+                    sh.removed.push_back(test_var);
+                    sh.not_indep++;
+                    sh.ret_false++;
+                } else {
+                    sh.st[test_var] = BackwSt::unknown;
+                    sh.unknown.push_back(test_var);
+                    sh.retried++;
+                }
+            } else {
+                // Independent, or timed out and we'll treat it as independent
+                sh.st[test_var] = BackwSt::indep;
+                sh.indep.push_back(test_var);
+                if (ret == l_True) sh.ret_true++;
+                else sh.ret_undef++;
+            }
+
+            if (sh.iter % mod == (mod-1) && conf.verb) {
+                std::stringstream ss;
+                ss << sh.ret_true << "/" << sh.ret_false << "/" << sh.ret_undef;
+                cout
+                << "c [arjun] iter: " << std::setw(5) << sh.iter
+                << " T/F/U: " << std::setw(10) << std::left << ss.str() << std::right
+                << " by: " << std::setw(3) << conf.num_threads
+                << " U: " << std::setw(7) << sh.unknown.size()
+                << " I: " << std::setw(7) << sh.indep.size()
+                << " N: " << std::setw(7) << sh.not_indep
+                << " R: " << std::setw(7) << sh.retried
+                << " T: " << std::setprecision(2) << std::fixed << (cpuTimeTotal() - my_time)
+                << endl;
+                my_time = cpuTimeTotal();
+                sh.ret_true = 0;
+                sh.ret_false = 0;
+                sh.ret_undef = 0;
+            }
+            sh.iter++;
+            sh.cv.notify_all();
+            if (status_due(status)) {
+                status.set(sh.iter, sh.unknown.size(), sh.indep.size(), sh.not_indep);
+                status.last_written = real_time_sec(); // so others don't write too
+                RoundStatus snap = status;
+                lk.unlock();
+                {
+                    std::lock_guard<std::mutex> slk(sh.status_mu);
+                    write_status(snap);
+                }
+                lk.lock();
+            }
+        }
+        lk.unlock();
+        delete s;
+    };
+
+    vector<std::thread> threads;
+    for(uint32_t i = 0; i < conf.num_threads; i++) threads.push_back(std::thread(worker));
+    for(auto& t: threads) t.join();
+    assert(sh.in_flight == 0);
+    sampling_set = sh.indep;
+    status.set(sh.iter, 0, sh.indep.size(), sh.not_indep);
+    write_status(status, true);
+
+    verb_print(1, "[arjun] parallel backward round finished."
+        << " I: " << sampling_set.size()
+        << " N: " << sh.not_indep
+        << " re-tested: " << sh.retried
+        << " T: " << std::setprecision(2) << std::fixed << (cpuTimeTotal() - start_round_time));
+}
+
+uint32_t Common::get_diff_var(const uint32_t var)
+{
+    assert(var < orig_num_vars);
+    var_to_diff.resize(orig_num_vars, var_Undef);
+    if (var_to_diff[var] != var_Undef) return var_to_diff[var];
+
+    solver->new_var();
+    const uint32_t diff = solver->nVars()-1;
+    var_to_diff[var] = diff;
+
+    // Below two mean var != (var+orig) in case diff is TRUE
+    vector<Lit> tmp;
+    tmp.push_back(Lit(var,               false));
+    tmp.push_back(Lit(var+orig_num_vars, false));
+    tmp.push_back(Lit(diff,              true));
+    solver->add_clause(tmp);
+
+    tmp.clear();
+    tmp.push_back(Lit(var,               true));
+    tmp.push_back(Lit(var+orig_num_vars, true));
+    tmp.push_back(Lit(diff,              true));
+    solver->add_clause(tmp);
+    return diff;
+}
+
+// Block size for group testing, from the fraction of variables found to be
+// independent so far. For binary splitting, about ln(2)/q is optimal, where q
+// is the probability of a variable being independent.
+uint32_t Common::backw_group_size(const uint64_t tot_indep, const uint64_t tot_not_indep) const
+{
+    const double q = (double)(tot_indep+1)/(double)(tot_indep+tot_not_indep+2);
+    const double k = 0.69/q;
+    if (k >= conf.backw_group_max) return conf.backw_group_max;
+    return std::max<uint32_t>(k, 1);
+}
+
+// Like backward_round(), but removes a block of variables at once: if none of
+// the variables in the block can differ between the two copies while the rest
+// of the set is kept equal, they are all defined by the rest. If the query is
+// SAT (or times out), the block is bisected.
+void Common::backward_round_group()
+{
+    for(const auto& x: seen) assert(x == 0);
+    double start_round_time = cpuTimeTotal();
+    vector<uint32_t> indep;
+
+    vector<uint32_t> unknown;
+    vector<char> unknown_set;
+    unknown_set.resize(orig_num_vars, 0);
+    for(const auto& x: sampling_set) {
+        assert(x < orig_num_vars);
+        assert(unknown_set[x] == 0 && "No var should be in 'sampling_set' twice!");
+        unknown.push_back(x);
+        unknown_set[x] = 1;
+    }
+    sort_unknown(unknown);
+    if (!conf.specified_order_fname.empty()) order_by_file(conf.specified_order_fname, unknown);
+    uint32_t iter = 0;
+    uint32_t not_indep = 0;
+    if (!conf.resume_fname.empty())
+        read_backw_checkpoint(unknown, unknown_set, indep, iter, not_indep);
+    const vector<uint32_t> order = unknown;
+    double last_checkpoint = real_time_sec();
+    print_sorted_unknown(unknown);
+    verb_print(1, "[arjun] Start unknown size: " << unknown.size()
+        << " max group size: " << conf.backw_group_max);
+
+    uint32_t mod = 1;
+    if ((sampling_set.size()) > 20 ) {
+        uint32_t will_do_iters = sampling_set.size();
+        uint32_t want_printed = 30;
+        mod = will_do_iters/want_printed;
+        mod = std::max<int>(mod, 1);
+    }
+
+    vector<Lit> assumptions;
+    vector<Lit> tmp;
+    vector<vector<uint32_t>> todo; // blocks still to be tested, last one is next
+
+    // One activation var for the whole round, not one per query. With it,
+    // at least one var of the round must differ. Diff vars only imply a
+    // difference, so the vars outside the block are turned off by assuming
+    // their diff vars false.
+    solver->new_var();
+    const uint32_t act = solver->nVars()-1;
+    tmp.clear();
+    tmp.push_back(Lit(act, true));
+    for(const auto& var: order) tmp.push_back(Lit(get_diff_var(var), false));
+    solver->add_clause(tmp);
+    vector<char> in_block(orig_num_vars, 0);
+
+    uint32_t ret_false = 0;
+    uint32_t ret_true = 0;
+    uint32_t ret_undef = 0;
+    uint64_t tot_indep = 0;
+    uint64_t tot_not_indep = 0;
+    uint32_t group_sz = 1;
+    double my_time = cpuTime();
+    RoundStatus status("backward", unknown.size());
+    const uint64_t start_confl = solver->get_sum_conflicts();
+    auto update_status = [&]() {
+        status.set(iter, unknown.size(), indep.size(), not_indep);
+        status.conflicts = solver->get_sum_conflicts() - start_confl;
+    };
+    while(true) {
+        if (todo.empty()) {
+            group_sz = backw_group_size(tot_indep, tot_not_indep);
+            vector<uint32_t> block;
+            while(!unknown.empty() && block.size() < group_sz) {
+                uint32_t var = unknown.back();
+                unknown.pop_back();
+                if (unknown_set[var]) block.push_back(var);
+            }
+            if (block.empty()) break;
+            todo.push_back(block);
+        }
+        const vector<uint32_t> block = todo.back();
+        todo.pop_back();
+        for(const auto& var: block) {
+            assert(unknown_set[var] == 1);
+            unknown_set[var] = 0;
+        }
+
+        // Everything still in the set, except the block, is kept equal
+        fill_assumptions_backward(assumptions, unknown, unknown_set, indep);
+        for(const auto& b: todo) for(const auto& var: b) {
+            assert(unknown_set[var] == 1);
+            assumptions.push_back(Lit(get_indic(var), false));
+        }
+
+        if (block.size() == 1) {
+            assumptions.push_back(Lit(block[0], false));
+            assumptions.push_back(Lit(block[0] + orig_num_vars, true));
+        } else {
+            // At least one var in the block must differ
+            for(const auto& var: block) in_block[var] = 1;
+            assumptions.push_back(Lit(act, false));
+            for(const auto& var: order)
+                if (!in_block[var]) assumptions.push_back(Lit(var_to_diff[var], true));
+            for(const auto& var: block) in_block[var] = 0;
+        }
+
+        solver->set_no_confl_needed();
+        solver->set_max_confl(conf.backw_max_confl);
+        const lbool ret = solver->solve(&assumptions);
+        status.add_ret(ret);
+        if (ret == l_False) ret_false++;
+        else if (ret == l_True) ret_true++;
+        else ret_undef++;
+
+        // Only vars differing in the model are candidates for being independent
+        uint32_t num_differ = 0;
+        uint32_t differ_var = var_Undef;
+        if (ret == l_True && block.size() > 1) {
+            for(const auto& var: block) {
+                if (solver->get_model()[var] != solver->get_model()[var+orig_num_vars]) {
+                    num_differ++;
+                    differ_var = var;
+                }
+            }
+            assert(num_differ > 0);
+        }
+
+        if (ret == l_False) {
+            // All of them are defined by the rest of the set
+            not_indep += block.size();
+            tot_not_indep += block.size();
+        } else if (block.size() == 1) {
+            // Independent, or timed out and we'll treat is as independent
+            indep.push_back(block[0]);
+            tot_indep++;
+        } else {
+            for(const auto& var: block) unknown_set[var] = 1;
+            if (num_differ == 1) {
+                // Everything else was equal, so this one cannot be defined
+                unknown_set[differ_var] = 0;
+                indep.push_back(differ_var);
+                tot_indep++;
+                vector<uint32_t> rest;
+                for(const auto& var: block) if (var != differ_var) rest.push_back(var);
+                todo.push_back(rest);
+            } else {
+                const auto half = block.begin() + block.size()/2;
+                todo.push_back(vector<uint32_t>(half, block.end()));
+                todo.push_back(vector<uint32_t>(block.begin(), half));
+            }
+        }
+
+        if (iter % mod == (mod-1) && conf.verb) {
+            std::stringstream ss;
+            ss << ret_true << "/" << ret_false << "/" << ret_undef;
+            cout
+            << "c [arjun] iter: " << std::setw(5) << iter
+            << " T/F/U: " << std::setw(10) << std::left << ss.str() << std::right
+            << " by: " << std::setw(3) << group_sz
+            << " U: " << std::setw(7) << unknown.size()
+            << " I: " << std::setw(7) << indep.size()
+            << " N: " << std::setw(7) << not_indep
+            << " T: " << std::setprecision(2) << std::fixed << (cpuTime() - my_time)
+            << endl;
+            my_time = cpuTime();
+            ret_true = 0;
+            ret_false = 0;
+            ret_undef = 0;
+        }
+        iter++;
+
+        if (iter % 500 == 499) {
+            update_sampling_set(unknown, unknown_set, indep);
+            for(const auto& b: todo) for(const auto& var: b) sampling_set.push_back(var);
+        }
+        // Vars in pending blocks are still marked in unknown_set
+        if (!conf.checkpoint_fname.empty() &&
+                real_time_sec() - last_checkpoint > conf.checkpoint_every) {
+            write_backw_checkpoint(order, unknown_set, indep, iter, not_indep);
+            last_checkpoint = real_time_sec();
+        }
+        if (status_due(status)) {
+            update_status();
+            write_status(status);
+        }
+    }
+    assert(todo.empty());
+    tmp.clear();
+    tmp.push_back(Lit(act, true));
+    solver->add_clause(tmp);
+    update_sampling_set(unknown, unknown_set, indep);
+    if (!conf.checkpoint_fname.empty())
+        write_backw_checkpoint(order, unknown_set, indep, iter, not_indep);
+    update_status();
+    write_status(status, true);
+
+    verb_print(1, "[arjun] group backward round finished."
+        << " I: " << sampling_set.size()
+        << " N: " << not_indep
+        << " queries: " << iter
+        << " T: " << std::setprecision(2) << std::fixed << (cpuTime() - start_round_time));
+    if (conf.verb >= 2) solver->print_stats();
+}
+
+// Var `var` is defined by the vars in `defined_by`
+struct PortfolioFact {
+    uint32_t var;
+    vector<uint32_t> defined_by;
+};
+
+struct PortfolioMember {
+    uint32_t unknown_sort;
+    vector<uint32_t> unknown; // stack of vars still to test
+    vector<char> st; // 0 = not in set, 1 = unknown, 2 = independent
+    vector<uint32_t> indep;
+    uint32_t not_indep = 0;
+    uint32_t imported = 0;
+    uint32_t iter = 0;
+    bool finished = false;
+
+    uint32_t set_size() const {
+        uint32_t sz = indep.size();
+        for(const auto& v: unknown) sz += (st[v] == 1);
+        return sz;
+    }
+};
+
+// Runs backward on several orderings at the same time, each with its own
+// solver copy. Every removal is published with the vars in the final conflict,
+// and other members import it if all those vars are still in their set. The
+// first member to finish wins. At the deadline, the smallest set so far wins,
+// which is valid since every intermediate set of backward is a valid support.
+// When the round is over, the solves still running are interrupted.
+void Common::backward_round_portfolio()
+{
+    for(const auto& x: seen) assert(x == 0);
+    double start_round_time = real_time_sec();
+    const double deadline = conf.portfolio_time > 0 ? start_round_time + conf.portfolio_time : 0;
+    // Every member's first query needs all of them
+    add_all_indics(sampling_set);
+    const auto cnf = get_init_cnf();
+
+    // Distinct incidence sorts first, the rest get random orders
+    vector<uint32_t> sorts = {(uint32_t)conf.unknown_sort};
+    for(uint32_t srt: {1U, 2U, 3U}) if (srt != sorts[0]) sorts.push_back(srt);
+    sorts.resize(conf.portfolio, 6);
+
+    vector<PortfolioMember> members(conf.portfolio);
+    for(uint32_t i = 0; i < members.size(); i++) {
+        auto& m = members[i];
+        m.unknown_sort = sorts[i];
+        m.st.resize(orig_num_vars, 0);
+        m.unknown = sampling_set;
+        for(const auto& v: sampling_set) m.st[v] = 1;
+        std::mt19937 rand(random_source());
+        sort_unknown(m.unknown, m.unknown_sort, rand);
+    }
+    verb_print(1, "[arjun] Start unknown size: " << sampling_set.size()
+        << " portfolio members: " << members.size());
+
+    std::mutex mu;
+    std::condition_variable cv;
+    vector<PortfolioFact> facts;
+    std::atomic<bool> done(false);
+    int winner = -1;
+    uint32_t running = members.size();
+    vector<SATSolver*> solvers(members.size(), nullptr);
+    // Call with `mu` held
+    auto stop_all = [&]() {
+        done = true;
+        for(const auto& s: solvers) if (s) s->interrupt_asap();
+    };
+    auto worker = [&](const uint32_t id) {
+        auto& m = members[id];
+        SATSolver* s = new_solver_copy(cnf);
+        {
+            std::lock_guard<std::mutex> lk(mu);
+            solvers[id] = s;
+        }
+        vector<Lit> assumptions;
+        size_t facts_at = 0;
+        while(!done) {
+            if (deadline > 0 && real_time_sec() > deadline) break;
+            {
+                std::lock_guard<std::mutex> lk(mu);
+                for(; facts_at < facts.size(); facts_at++) {
+                    const auto& f = facts[facts_at];
+                    if (m.st[f.var] != 1) continue;
+                    bool ok = true;
+                    for(const auto& v: f.defined_by) if (m.st[v] == 0) {ok = false; break;}
+                    if (!ok) continue;
+                    m.st[f.var] = 0;
+                    m.not_indep++;
+                    m.imported++;
+                }
+            }
+
+            uint32_t test_var = var_Undef;
+            while(!m.unknown.empty()) {
+                uint32_t var = m.unknown.back();
+                m.unknown.pop_back();
+                if (m.st[var] == 1) {
+                    test_var = var;
+                    break;
+                }
+            }
+            if (test_var == var_Undef) {
+                std::lock_guard<std::mutex> lk(mu);
+                m.finished = true;
+                if (winner == -1) winner = id;
+                stop_all();
+                break;
+            }
+
+            assumptions.clear();
+            for(const auto& var: m.indep) assumptions.push_back(Lit(var_to_indic[var], false));
+            for(const auto& var: m.unknown) {
+                if (m.st[var] != 1) continue;
+                assumptions.push_back(Lit(var_to_indic[var], false));
+            }
+            assumptions.push_back(Lit(test_var, false));
+            assumptions.push_back(Lit(test_var + orig_num_vars, true));
+            if (done) break;
+            s->set_max_confl(conf.backw_max_confl);
+            const lbool ret = s->solve(&assumptions);
+            m.iter++;
+
+            if (ret == l_False) {
+                m.st[test_var] = 0;
+                m.not_indep++;
+                PortfolioFact f;
+                f.var = test_var;
+                for(const auto& l: s->get_conflict()) {
+                    if (l.var() >= indic_to_var.size()) continue;
+                    const uint32_t var = indic_to_var[l.var()];
+                    if (var != var_Undef) f.defined_by.push_back(var);
+                }
+                std::lock_guard<std::mutex> lk(mu);
+                facts.push_back(std::move(f));
+            } else {
+                // Independent, or timed out and we'll treat it as independent
+                m.st[test_var] = 2;
+                m.indep.push_back(test_var);
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lk(mu);
+            solvers[id] = nullptr;
+            running--;
+        }
+        cv.notify_all();
+        delete s;
+    };
+
+    vector<std::thread> threads;
+    for(uint32_t i = 0; i < members.size(); i++) threads.push_back(std::thread(worker, i));
+    if (deadline > 0) {
+        std::unique_lock<std::mutex> lk(mu);
+        const std::chrono::duration<double> left(std::max(deadline - real_time_sec(), 0.0));
+        if (!cv.wait_for(lk, left, [&]() { return running == 0; })) {
+            verb_print(1, "[arjun] portfolio deadline reached, interrupting members");
+            stop_all();
+        }
+    }
+    for(auto& t: threads) t.join();
+
+    if (winner == -1) {
+        winner = 0;
+        for(uint32_t i = 1; i < members.size(); i++) {
+            if (members[i].set_size() < members[winner].set_size()) winner = i;
+        }
+    }
+    for(uint32_t i = 0; i < members.size(); i++) {
+        const auto& m = members[i];
+        verb_print(1, "[arjun] portfolio member: " << i
+            << " sort: " << m.unknown_sort
+            << " finished: " << m.finished
+            << " set size: " << m.set_size()
+            << " N: " << m.not_indep
+            << " imported: " << m.imported
+            << " queries: " << m.iter);
+    }
+
+    const auto& w = members[winner];
+    sampling_set = w.indep;
+    for(const auto& v: w.unknown) if (w.st[v] == 1) sampling_set.push_back(v);
+    verb_print(1, "[arjun] portfolio backward round finished."
+        << " winner: " << winner
+        << " I: " << sampling_set.size()
+        << " facts shared: " << facts.size()
+        << " wall T: " << std::setprecision(2) << std::fixed << (real_time_sec() - start_round_time));
+}
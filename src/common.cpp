@@ -29,6 +29,8 @@
 #include "cryptominisat5/solvertypesmini.h"
 #endif
 #include "src/arjun.h"
+#include <cstdio>
+#include <fstream>
 #include <limits>
 
 using namespace ArjunInt;
@@ -68,48 +70,67 @@ void Common::print_orig_sampling_set()
     cout << "c [arjun] Orig size         : " << sampling_set.size() << endl;
 }
 
+// Indicator variables are created lazily by get_indic(), so only variables
+// that actually end up in an assumption set get one. Backward's first query
+// already holds every var of the sampling set, so the saving is in extend,
+// where only the vars found to be defined get one.
 void Common::add_fixed_clauses()
 {
-    double fix_cl_time = cpuTime();
     dont_elim.clear();
     var_to_indic.clear();
     var_to_indic.resize(orig_num_vars, var_Undef);
     indic_to_var.clear();
     indic_to_var.resize(solver->nVars(), var_Undef);
-
-    //If indicator variable is TRUE, they are FORCED EQUAL
-    vector<Lit> tmp;
-    for(uint32_t var: sampling_set) {
-        solver->new_var();
-        uint32_t this_indic = solver->nVars()-1;
-        //torem_orig.push_back(Lit(this_indic, false));
-        var_to_indic[var] = this_indic;
-        dont_elim.push_back(Lit(this_indic, false));
-        indic_to_var.resize(this_indic+1, var_Undef);
-        indic_to_var[this_indic] = var;
-
-        // Below two mean var == (var+orig) in case indic is TRUE
-        tmp.clear();
-        tmp.push_back(Lit(var,               false));
-        tmp.push_back(Lit(var+orig_num_vars, true));
-        tmp.push_back(Lit(this_indic,        true));
-        solver->add_clause(tmp);
-
-        tmp.clear();
-        tmp.push_back(Lit(var,               true));
-        tmp.push_back(Lit(var+orig_num_vars, false));
-        tmp.push_back(Lit(this_indic,        true));
-        solver->add_clause(tmp);
-    }
+    num_indics = 0;
 
     //Don't eliminate the sampling variables
     for(uint32_t var: sampling_set) {
         dont_elim.push_back(Lit(var, false));
         dont_elim.push_back(Lit(var+orig_num_vars, false));
     }
-    if (conf.verb) {
-        cout << "c [arjun] Adding fixed clauses time: " << (cpuTime()-fix_cl_time) << endl;
-    }
+}
+
+uint32_t Common::get_indic(const uint32_t var)
+{
+    assert(var < orig_num_vars);
+    if (var_to_indic[var] != var_Undef) return var_to_indic[var];
+
+    const uint32_t this_indic = new_indic(solver, var);
+    var_to_indic[var] = this_indic;
+    dont_elim.push_back(Lit(this_indic, false));
+    // Keep it covering all variables, fast backward looks up any assumption
+    indic_to_var.resize(this_indic+1, var_Undef);
+    indic_to_var[this_indic] = var;
+    num_indics++;
+    return this_indic;
+}
+
+// New indicator var in `s`, without touching the maps, so worker threads can
+// add them to their own solver copies
+uint32_t Common::new_indic(SATSolver* s, const uint32_t var) const
+{
+    //If indicator variable is TRUE, they are FORCED EQUAL
+    s->new_var();
+    const uint32_t indic = s->nVars()-1;
+
+    // Below two mean var == (var+orig) in case indic is TRUE
+    vector<Lit> tmp;
+    tmp.push_back(Lit(var,               false));
+    tmp.push_back(Lit(var+orig_num_vars, true));
+    tmp.push_back(Lit(indic,             true));
+    s->add_clause(tmp);
+
+    tmp.clear();
+    tmp.push_back(Lit(var,               true));
+    tmp.push_back(Lit(var+orig_num_vars, false));
+    tmp.push_back(Lit(indic,             true));
+    s->add_clause(tmp);
+    return indic;
+}
+
+void Common::add_all_indics(const vector<uint32_t>& vars)
+{
+    for(const auto& var: vars) get_indic(var);
 }
 
 void Common::duplicate_problem() {
@@ -117,20 +138,113 @@ void Common::duplicate_problem() {
 
     //Duplicate the already simplified problem
     if (conf.verb) cout << "c [arjun] Duplicating CNF..." << endl;
+    PhaseTimer phase(phase_stats, "duplicate");
     double dupl_time = cpuTime();
     auto cnf = get_init_cnf();
 
     solver->new_vars(orig_num_vars);
-    for(auto& cl: cnf.cnf) {
-        for(auto& l: cl) l = Lit(l.var()+orig_num_vars, l.sign());
-        solver->add_clause(cl);
+    for(auto& l: cnf.cnf.all_lits()) l = Lit(l.var()+orig_num_vars, l.sign());
+    vector<Lit> tmp;
+    for(const auto& cl: cnf.cnf) {
+        tmp.assign(cl.begin(), cl.end());
+        solver->add_clause(tmp);
     }
+    phase.count("clauses", cnf.cnf.size());
     if (conf.verb) cout << "c [arjun] Duplicated CNF. T: " << (cpuTime() - dupl_time) << endl;
 }
 
+// Rewritten as a whole via a temporary file and rename, so readers never see
+// a half-written file. Failing to write it is not fatal, the run goes on.
+void Common::write_status(RoundStatus& st, const bool finished)
+{
+    if (conf.status_fname.empty()) return;
+    const double now = real_time_sec();
+    st.last_written = now;
+    const double elapsed = std::max(now - st.start_time, 1e-9);
+    const uint64_t queries = st.ret_true + st.ret_false + st.ret_undef;
+    // Rough: assumes vars keep getting decided at the rate seen so far
+    const double vars_per_sec = (double)(st.start_unknown - std::min(st.unknown, st.start_unknown))/elapsed;
+    double vm;
+    const uint64_t rss = memUsedTotal(vm);
+
+    const string tmp_fname = conf.status_fname + ".tmp";
+    std::ofstream outf(tmp_fname.c_str(), std::ios::out);
+    outf << std::fixed << std::setprecision(2)
+        << "{\"round\": \"" << st.round << "\""
+        << ", \"finished\": " << (finished ? "true" : "false")
+        << ", \"elapsed\": " << elapsed
+        << ", \"iter\": " << st.iter
+        << ", \"unknown\": " << st.unknown
+        << ", \"indep\": " << st.indep
+        << ", \"not_indep\": " << st.not_indep
+        << ", \"ret_true\": " << st.ret_true
+        << ", \"ret_false\": " << st.ret_false
+        << ", \"ret_undef\": " << st.ret_undef
+        << ", \"queries_per_sec\": " << queries/elapsed
+        << ", \"fast_backw_avg\": " << (double)st.fast_backw_tot/(double)std::max<uint64_t>(st.fast_backw_calls, 1)
+        << ", \"fast_backw_max\": " << st.fast_backw_max
+        << ", \"conflicts\": " << st.conflicts
+        << ", \"conflicts_per_sec\": " << st.conflicts/elapsed
+        << ", \"rss\": " << rss
+        << ", \"eta\": " << (finished ? 0.0 : (vars_per_sec > 0 ? st.unknown/vars_per_sec : -1.0))
+        << "}\n";
+    outf.close();
+    if (!outf || std::rename(tmp_fname.c_str(), conf.status_fname.c_str()) != 0) {
+        cout << "c WARNING: could not write status file '" << conf.status_fname << "'" << endl;
+    }
+}
+
 ArjunNS::SimplifiedCNF Common::get_init_cnf() {
     ArjunNS::SimplifiedCNF cnf;
+    get_init_cnf(cnf);
+    return cnf;
+}
 
+static uint64_t mix64(uint64_t x)
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+// 128 bit hash of the input clauses, the set `vars` and `extra`, as 32 hex
+// digits. Clauses are hashed one by one with their literals sorted, and
+// combined in an order-independent way, so shuffling the clauses or the
+// literals in them gives the same hash. So does reordering `vars`.
+string Common::formula_hash(const vector<uint32_t>& vars, const vector<uint64_t>& extra) const
+{
+    uint64_t h1 = mix64(orig_num_vars);
+    uint64_t h2 = mix64(orig_num_vars ^ 0x9e3779b97f4a7c15ULL);
+    vector<uint32_t> tmp;
+    for(const auto& cl: orig_cnf.cnf) {
+        tmp.clear();
+        for(const auto& l: cl) tmp.push_back(l.toInt());
+        std::sort(tmp.begin(), tmp.end());
+        uint64_t c = tmp.size();
+        for(const auto& x: tmp) c = mix64(c ^ x);
+        h1 += mix64(c);
+        h2 ^= mix64(c ^ 0x9e3779b97f4a7c15ULL);
+    }
+
+    tmp = vars;
+    std::sort(tmp.begin(), tmp.end());
+    uint64_t s = tmp.size();
+    for(const auto& v: tmp) s = mix64(s ^ v);
+    for(const auto& x: extra) s = mix64(s ^ x);
+    h1 = mix64(h1 ^ s);
+    h2 = mix64(h2 + s);
+
+    std::stringstream ss;
+    ss << std::hex << std::setfill('0') << std::setw(16) << h1 << std::setw(16) << h2;
+    return ss.str();
+}
+
+// Reuses the space already allocated in `cnf`
+void Common::get_init_cnf(ArjunNS::SimplifiedCNF& cnf) {
+    cnf.clear();
     vector<Lit> clause;
     bool is_xor, rhs;
     solver->start_getting_constraints(false);
@@ -150,8 +264,6 @@ ArjunNS::SimplifiedCNF Common::get_init_cnf() {
         //todo
     }
 #endif
-
-    return cnf;
 }
 
 void Common::get_incidence()
@@ -189,6 +301,64 @@ void Common::set_up_solver()
     solver->set_distill(conf.distill && conf.simp);
     solver->set_sls(false);
     solver->set_find_xors(false);
+    if (pred_forever_cutoff_set) solver->set_pred_forever_cutoff(pred_forever_cutoff);
+    if (every_pred_reduce_set) solver->set_every_pred_reduce(every_pred_reduce);
+}
+
+// Forgets the formula and everything derived from it. The vectors are
+// cleared, not freed, so a next formula of similar size needs no
+// reallocation. Simplification may turn off parts of the config, so it is
+// restored to what it was when the last formula was started.
+void Common::reset() {
+    delete solver;
+    solver = nullptr;
+    conf = user_conf;
+    random_source.seed(conf.seed);
+    set_up_solver();
+
+    already_duplicated = false;
+    backward_done = false;
+    sampling_set.clear();
+    orig_sampling_vars.clear();
+    empty_sampling_vars.clear();
+    set_sampling_vars.clear();
+    seen.clear();
+    orig_num_vars = std::numeric_limits<uint32_t>::max();
+    definitely_satisfiable = false;
+    phase_stats.clear();
+    var_to_indic.clear();
+    indic_to_var.clear();
+    num_indics = 0;
+    var_to_diff.clear();
+    incidence.clear();
+    incidence_probing.clear();
+    dont_elim.clear();
+    orig_cnf.clear();
+    toClear.clear();
+    gate_defs.clear();
+}
+
+// Fresh solver loaded with `cnf` (usually get_init_cnf() of the duplicated
+// formula). Only reads `cnf` and the config, so worker threads can call it.
+SATSolver* Common::new_solver_copy(const ArjunNS::SimplifiedCNF& cnf) const
+{
+    SATSolver* s = new SATSolver;
+    s->set_up_for_arjun();
+    s->set_renumber(0);
+    s->set_bve(0);
+    s->set_verbosity(0);
+    s->set_intree_probe(conf.intree && conf.simp);
+    s->set_distill(conf.distill && conf.simp);
+    s->set_sls(false);
+    s->set_find_xors(false);
+    s->set_simplify(conf.simp);
+    s->new_vars(cnf.nvars);
+    vector<Lit> tmp;
+    for(const auto& cl: cnf.cnf) {
+        tmp.assign(cl.begin(), cl.end());
+        s->add_clause(tmp);
+    }
+    return s;
 }
 
 bool Common:: simplify_bve_only() {
@@ -205,6 +375,7 @@ bool Common:: simplify_bve_only() {
     }
 
     if (conf.simp) {
+        PhaseTimer phase(phase_stats, "bve");
         solver->set_bve(1);
         solver->set_verbosity(std::max(conf.verb-2, 0));
         string str("occ-bve");
@@ -240,7 +411,7 @@ void check_sanity_sampling_vars(T vars, const uint32_t nvars)
 }
 
 void Common::init() {
-    orig_cnf = get_init_cnf();
+    get_init_cnf(orig_cnf);
     assert(orig_num_vars  == std::numeric_limits<uint32_t>::max() && "double init");
     orig_num_vars = solver->nVars();
     check_sanity_sampling_vars(sampling_set, orig_num_vars);
@@ -248,6 +419,42 @@ void Common::init() {
     seen.resize(solver->nVars(), 0);
 }
 
+// Clause added after the backward round. Adding clauses can only make
+// variables more defined, so removed variables stay removed, and only the
+// current sampling set needs to be re-checked by the next backward round.
+bool Common::add_clause_incremental(const vector<Lit>& lits)
+{
+    assert(already_duplicated);
+    for(const auto& l: lits) {
+        if (l.var() >= orig_num_vars) {
+            cout << "ERROR: clause added after indep support calculation contains variable "
+                << l.var()+1 << " which is larger than the number of variables: "
+                << orig_num_vars << endl;
+            exit(-1);
+        }
+    }
+    // UNSAT stays UNSAT, and the copy may not even exist
+    if (!solver->okay()) return false;
+    orig_cnf.cnf.push_back(lits);
+    definitely_satisfiable = false;
+
+    // Empty variables are not empty anymore, they have to be re-checked
+    for(const auto& l: lits) seen[l.var()] = 1;
+    uint32_t j = 0;
+    for(uint32_t i = 0; i < empty_sampling_vars.size(); i++) {
+        const uint32_t v = empty_sampling_vars[i];
+        if (seen[v]) sampling_set.push_back(v);
+        else empty_sampling_vars[j++] = v;
+    }
+    empty_sampling_vars.resize(j);
+    for(const auto& l: lits) seen[l.var()] = 0;
+
+    vector<Lit> shifted;
+    for(const auto& l: lits) shifted.push_back(Lit(l.var()+orig_num_vars, l.sign()));
+    solver->add_clause(lits);
+    return solver->add_clause(shifted);
+}
+
 bool Common::preproc_and_duplicate() {
     assert(!already_duplicated);
     already_duplicated = true;
@@ -70,6 +70,7 @@
 #endif
 
 #include "time_mem.h"
+#include "phase_stats.h"
 #include "config.h"
 
 using namespace CMSat;
@@ -82,16 +83,95 @@ using std::vector;
 
 namespace ArjunInt {
 
+// Assumptions kept between solve() calls in a stable order: indicators of the
+// known independent vars first, then the rest. This only saves rebuilding the
+// vector, CMS cancels to level 0 and propagates all assumptions at every
+// solve() anyway.
+struct AssumpStack {
+    vector<Lit> lits;
+    uint32_t num_indep = 0;
+
+    void add_indep(const Lit l) {
+        lits.insert(lits.begin() + num_indep, l);
+        num_indep++;
+    }
+    void pop_test(const uint32_t num) { lits.resize(lits.size() - num); }
+    void clear() {
+        lits.clear();
+        num_indep = 0;
+    }
+};
+
+// Progress of a backward/extend round, see Common::write_status(). The
+// ret/fast-backw counts are totals since the start of the round.
+struct RoundStatus {
+    RoundStatus(const char* _round, const uint64_t _start_unknown) :
+        round(_round), start_unknown(_start_unknown) {}
+    void add_ret(const CMSat::lbool ret) {
+        if (ret == CMSat::l_True) ret_true++;
+        else if (ret == CMSat::l_False) ret_false++;
+        else ret_undef++;
+    }
+    void add_fast_backw(const uint64_t removed) {
+        fast_backw_calls++;
+        fast_backw_tot += removed;
+        fast_backw_max = std::max(fast_backw_max, removed);
+    }
+    void set(const uint64_t _iter, const uint64_t _unknown,
+            const uint64_t _indep, const uint64_t _not_indep) {
+        iter = _iter;
+        unknown = _unknown;
+        indep = _indep;
+        not_indep = _not_indep;
+    }
+
+    const char* round;
+    const uint64_t start_unknown;
+    const double start_time = real_time_sec();
+    double last_written = start_time;
+    uint64_t iter = 0;
+    uint64_t unknown = 0;
+    uint64_t indep = 0;
+    uint64_t not_indep = 0;
+    uint64_t ret_true = 0;
+    uint64_t ret_false = 0;
+    uint64_t ret_undef = 0;
+    uint64_t fast_backw_calls = 0;
+    uint64_t fast_backw_tot = 0;
+    uint64_t fast_backw_max = 0;
+    uint64_t conflicts = 0; // by all solvers of the round
+};
+
+// Sampling vars removed by a gate-based step, and what they are a function
+// of. Kept so they can be cached on disk, see Common::gate_cache_fname()
+enum class GateDefT {xor_gate, or_gate, ite_gate, irreg};
+struct GateDef {
+    GateDefT t;
+    vector<uint32_t> defined;
+    vector<uint32_t> inputs;
+};
+
 struct Common
 {
     Common() {
         set_up_solver();
     }
     ~Common() { delete solver; }
+    void reset();
 
+    // What is used. Simplification and extension turn some options off for
+    // the formula at hand, so this may differ from user_conf.
     Config conf;
+    // As set through Arjun's setters, conf is reset to it by reset()
+    Config user_conf;
+    // Set directly on the solver, kept so reset() can set them again
+    int pred_forever_cutoff = -1;
+    bool pred_forever_cutoff_set = false;
+    int every_pred_reduce = -1;
+    bool every_pred_reduce_set = false;
     CMSat::SATSolver* solver = nullptr;
     bool already_duplicated = false;
+    bool backward_done = false; // clauses can be added incrementally after
     vector<uint32_t> sampling_set;
     vector<uint32_t> orig_sampling_vars;
     vector<uint32_t> empty_sampling_vars;
@@ -100,11 +180,15 @@ struct Common
     vector<char> seen;
     uint32_t orig_num_vars = std::numeric_limits<uint32_t>::max();
     bool definitely_satisfiable = false;
+    vector<ArjunNS::PhaseStats> phase_stats;
     enum ModeType {one_mode, many_mode};
 
     //assert indic[var] to FASLE to force var==var+orig_num_vars
     vector<uint32_t> var_to_indic; //maps an ORIG VAR to an INDICATOR VAR
     vector<uint32_t> indic_to_var; //maps an INDICATOR VAR to ORIG VAR
+    uint32_t num_indics = 0;
+    //assert diff[var] to TRUE to force var!=var+orig_num_vars, created lazily
+    vector<uint32_t> var_to_diff;
 
     //Incidence as counted by clauses it's appeared together with other variables
     vector<uint32_t> incidence;
@@ -123,14 +207,20 @@ struct Common
         const vector<uint32_t>& indep
     );
     bool preproc_and_duplicate();
+    bool add_clause_incremental(const vector<Lit>& lits);
     void add_fixed_clauses();
-    void add_all_indics();
+    uint32_t get_indic(const uint32_t var);
+    uint32_t new_indic(SATSolver* s, const uint32_t var) const;
+    void add_all_indics(const vector<uint32_t>& vars);
     void print_orig_sampling_set();
     void start_with_clean_sampling_set();
     void duplicate_problem();
     void get_incidence();
     void set_up_solver();
+    SATSolver* new_solver_copy(const ArjunNS::SimplifiedCNF& cnf) const;
     ArjunNS::SimplifiedCNF get_init_cnf();
+    void get_init_cnf(ArjunNS::SimplifiedCNF& cnf);
+    string formula_hash(const vector<uint32_t>& vars, const vector<uint64_t>& extra) const;
     std::mt19937 random_source = std::mt19937(0);
 
     //simp
@@ -142,21 +232,59 @@ struct Common
     void remove_eq_literals(bool print = true);
     void get_empty_occs();
     bool probe_all();
+    bool probe_all_par();
     void empty_out_indep_set_if_unsat();
     bool simplify_bve_only();
     bool run_gauss_jordan();
     void check_no_duplicate_in_sampling_set();
     void order_sampl_set_for_simp();
 
+    // gate definition cache
+    vector<GateDef> gate_defs; // found by this run, in the order found
+    string gate_cache_fname() const;
+    bool load_gate_cache(const string& fname, vector<GateDef>& defs);
+    void save_gate_cache(const string& fname) const;
+    void apply_gate_defs(const vector<GateDef>& defs);
+
     //backward
     void fill_assumptions_backward(
         vector<Lit>& assumptions,
         vector<uint32_t>& unknown,
         const vector<char>& unknown_set,
         const vector<uint32_t>& indep);
+    void sync_assumptions_backward(
+        AssumpStack& as,
+        vector<uint32_t>& unknown,
+        const vector<char>& unknown_set,
+        const vector<uint32_t>& indep);
     void backward_round();
+    void backward_round_par();
+    uint32_t initial_backw_budget() const;
+    bool escalate_backw_budget(uint32_t& max_confl, const double start_time) const;
+    void backward_round_group();
+    void backward_round_portfolio();
+    uint32_t get_diff_var(const uint32_t var);
+    uint32_t backw_group_size(const uint64_t tot_indep, const uint64_t tot_not_indep) const;
     void order_by_file(const string& fname, vector<uint32_t>& unknown);
     void print_sorted_unknown(const vector<uint32_t>& unknown) const;
+    string backw_checkpoint_key(const vector<uint32_t>& order) const;
+    void write_backw_checkpoint(
+        const vector<uint32_t>& order,
+        const vector<char>& unknown_set,
+        const vector<uint32_t>& indep,
+        const uint32_t iter,
+        const uint32_t not_indep);
+    bool status_due(const RoundStatus& st) const {
+        return !conf.status_fname.empty() &&
+            real_time_sec() - st.last_written >= conf.status_every;
+    }
+    void write_status(RoundStatus& st, const bool finished = false);
+    void read_backw_checkpoint(
+        vector<uint32_t>& unknown,
+        vector<char>& unknown_set,
+        vector<uint32_t>& indep,
+        uint32_t& iter,
+        uint32_t& not_indep);
 
     // extend
     template<class T>
@@ -164,9 +292,11 @@ struct Common
         vector<Lit>& assumptions,
         const T& indep);
     void extend_round();
+    void extend_round_par(const vector<uint32_t>& indep, const vector<uint32_t>& unknown);
 
     //Sorting
     template<class T> void sort_unknown(T& unknown);
+    template<class T> void sort_unknown(T& unknown, const uint32_t unknown_sort, std::mt19937& rand);
 
 };
 
@@ -237,14 +367,20 @@ struct IncidenceSorter2
 template<class T>
 void Common::sort_unknown(T& unknown)
 {
-    if (conf.unknown_sort == 1) {
+    sort_unknown(unknown, conf.unknown_sort, random_source);
+}
+
+template<class T>
+void Common::sort_unknown(T& unknown, const uint32_t unknown_sort, std::mt19937& rand)
+{
+    if (unknown_sort == 1) {
         std::sort(unknown.begin(), unknown.end(), IncidenceSorter<uint32_t>(incidence));
-    } else if (conf.unknown_sort == 2) {
+    } else if (unknown_sort == 2) {
         std::sort(unknown.begin(), unknown.end(), IncidenceSorter2<uint32_t>(incidence, incidence_probing));
-    } else if (conf.unknown_sort == 3) {
+    } else if (unknown_sort == 3) {
         std::sort(unknown.begin(), unknown.end(), IncidenceSorter<uint32_t>(incidence_probing));
-    } else if (conf.unknown_sort == 6) {
-        std::shuffle(unknown.begin(), unknown.end(), random_source);
+    } else if (unknown_sort == 6) {
+        std::shuffle(unknown.begin(), unknown.end(), rand);
     } else {
         cout << "ERROR: wrong sorting mechanism given" << endl;
         exit(-1);
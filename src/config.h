@@ -50,7 +50,20 @@ struct Config {
     int bce = 0;
     double no_gates_below = 0.01;
     std::string specified_order_fname;
+    std::string checkpoint_fname;
+    double checkpoint_every = 600; // wall-clock seconds
+    std::string resume_fname;
+    std::string status_fname;
+    double status_every = 10; // wall-clock seconds
+    std::string gate_cache_dir; // empty = no gate definition cache
     uint32_t backw_max_confl = 5000*10;
+    uint32_t backw_confl_start = 0; // 0 = always use backw_max_confl
+    double backw_confl_mult = 4;
+    double backw_max_time = 0; // for escalating budgets, 0 = no limit
+    uint32_t num_threads = 1;
+    uint32_t backw_group_max = 0; // 0 or 1 means one var per query
+    uint32_t portfolio = 0; // number of orderings raced, 0 or 1 means off
+    double portfolio_time = 0; // wall-clock deadline for the portfolio, 0 = no limit
     int bve_during_elimtofile = true;
     bool weighted = false;
 };
@@ -0,0 +1,460 @@
+/*
+ Arjun
+
+ Copyright (c) 2019-2020, Mate Soos and Kuldeep S. Meel. All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <cstdlib>
+#include <limits>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <gmpxx.h>
+#include <thread>
+#include <cryptominisat5/solvertypesmini.h>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define ARJUN_HAVE_MMAP
+#endif
+
+// Plain-text DIMACS parser working directly on the mmap()-ed file, no copying
+// or per-character stream calls. Understands what write_simpcnf() writes:
+// the header, clauses, "c ind"/"c p show" projections, "c red" clauses,
+// "c p weight" and "c MUST MULTIPLY BY". Compressed input is not handled, use
+// DimacsParser for that.
+//
+// The file is cut at newlines into chunks. tokenize() turns a chunk into the
+// clause literals plus the header/comment lines, and merge() feeds them to
+// the solver in file order. parse() and parse_par() only differ in how many
+// chunks are tokenized at the same time, so they read every file the same.
+template<class S>
+class MmapDimacsParser
+{
+public:
+    MmapDimacsParser(S* _solver) : solver(_solver) {}
+    ~MmapDimacsParser() { unmap(); }
+
+    // False if the file cannot be mapped (or is gzipped), nothing is read then
+    bool map(const std::string& fname);
+    // One chunk at a time, so the tokens take little memory
+    bool parse();
+    // Tokenizes newline-aligned chunks on `num_threads` threads, then feeds
+    // the clauses to the solver in file order
+    bool parse_par(const uint32_t num_threads);
+    size_t size() const { return sz; }
+    bool sampl_vars_given() const { return !sampl_vars.empty() || got_ind; }
+
+private:
+    // Tokens of one chunk: the clause literals with 0 as terminator, plus the
+    // header/comment lines that are parsed when merging, at position `at`
+    struct Chunk {
+        struct Line {
+            size_t at;
+            const char* from;
+            const char* to;
+        };
+        std::vector<int32_t> toks;
+        std::vector<Line> lines;
+        const char* err_at = nullptr;
+        std::string err;
+        void clear() {
+            toks.clear();
+            lines.clear();
+            err_at = nullptr;
+            err.clear();
+        }
+    };
+    static constexpr size_t seq_chunk_sz = 8*1024*1024;
+    const char* chunk_end(const char* from, const size_t chunk_sz) const {
+        if ((size_t)(end-from) <= chunk_sz) return end;
+        const void* nl = memchr(from + chunk_sz, '\n', end - (from + chunk_sz));
+        return nl ? (const char*)nl + 1 : end;
+    }
+    void tokenize(const char* from, const char* to, Chunk& c) const;
+    bool merge(const Chunk& c);
+    bool finish();
+    bool parse_lines();
+
+    void unmap();
+    static bool read_int(const char*& at, const char* e, int64_t& val);
+    bool parse_int(int64_t& val);
+    bool parse_lits_until_zero(std::vector<CMSat::Lit>& lits);
+    bool parse_header();
+    bool parse_comment();
+    bool parse_red_clause();
+    void skip_line() {
+        const void* nl = memchr(p, '\n', end-p);
+        p = nl ? (const char*)nl + 1 : end;
+    }
+    void skip_space() { while(p < end && (*p == ' ' || *p == '\t' || *p == '\r')) p++; }
+    bool match(const char* word) {
+        const size_t len = strlen(word);
+        if ((size_t)(end-p) < len || memcmp(p, word, len) != 0) return false;
+        p += len;
+        return true;
+    }
+    bool error(const std::string& msg) {
+        std::cerr << "PARSE ERROR! " << msg << " At line " << line_num() << std::endl;
+        return false;
+    }
+    bool error_no_line(const std::string& msg) const {
+        std::cerr << "PARSE ERROR! " << msg << std::endl;
+        return false;
+    }
+    size_t line_num() const {
+        size_t n = 1;
+        for(const char* at = data; at < p; at++) n += (*at == '\n');
+        return n;
+    }
+
+    S* solver;
+    const char* data = nullptr;
+    const char* p = nullptr;
+    const char* end = nullptr;
+    size_t sz = 0;
+    bool header_found = false;
+    bool got_ind = false;
+    uint32_t hdr_vars = 0;
+    std::vector<CMSat::Lit> lits;
+    std::vector<CMSat::Lit> pending; // clause being merged, may span chunks
+    std::vector<uint32_t> sampl_vars;
+};
+
+template<class S>
+bool MmapDimacsParser<S>::map(const std::string& fname)
+{
+#ifdef ARJUN_HAVE_MMAP
+    int fd = open(fname.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+        close(fd);
+        return false;
+    }
+    void* m = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (m == MAP_FAILED) return false;
+    data = (const char*)m;
+    sz = st.st_size;
+    if (sz >= 2 && (unsigned char)data[0] == 0x1f && (unsigned char)data[1] == 0x8b) {
+        unmap();
+        return false;
+    }
+    madvise(m, sz, MADV_SEQUENTIAL);
+    p = data;
+    end = data + sz;
+    return true;
+#else
+    (void)fname;
+    return false;
+#endif
+}
+
+template<class S>
+void MmapDimacsParser<S>::unmap()
+{
+#ifdef ARJUN_HAVE_MMAP
+    if (data) munmap((void*)data, sz);
+#endif
+    data = p = end = nullptr;
+    sz = 0;
+}
+
+// Length of the run of digits at `at` is found 8 bytes at a time, reading
+// past `e` is avoided by only doing so when 8 bytes are left
+template<class S>
+bool MmapDimacsParser<S>::read_int(const char*& at, const char* e, int64_t& val)
+{
+    const char* q = at;
+    bool neg = false;
+    if (q < e && (*q == '-' || *q == '+')) {
+        neg = (*q == '-');
+        q++;
+    }
+    size_t len = 0;
+    bool found_end = false;
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    while(!found_end && e - (q+len) >= 8) {
+        uint64_t x;
+        memcpy(&x, q+len, 8);
+        // A byte is a digit iff its high nibble is 3, and stays 3 after adding 6
+        const uint64_t hi = 0xF0F0F0F0F0F0F0F0ULL;
+        const uint64_t three = 0x3030303030303030ULL;
+        uint64_t m = ((x & hi) ^ three) | (((x + 0x0606060606060606ULL) & hi) ^ three);
+        // Top bit of each non-zero byte (no carries between bytes)
+        m = (((m & 0x7F7F7F7F7F7F7F7FULL) + 0x7F7F7F7F7F7F7F7FULL) | m) & 0x8080808080808080ULL;
+        if (m) {
+            len += __builtin_ctzll(m) / 8;
+            found_end = true;
+        } else len += 8;
+    }
+#endif
+    if (!found_end) while(q+len < e && q[len] >= '0' && q[len] <= '9') len++;
+    if (len == 0 || len > 18) return false;
+    int64_t v = 0;
+    for(size_t i = 0; i < len; i++) v = v*10 + (q[i] - '0');
+    at = q + len;
+    val = neg ? -v : v;
+    return true;
+}
+
+template<class S>
+bool MmapDimacsParser<S>::parse_int(int64_t& val)
+{
+    skip_space();
+    if (!read_int(p, end, val)) {
+        return error(std::string("Expected a number of at most 18 digits, found: '")
+            + (p < end ? *p : ' ') + "'");
+    }
+    return true;
+}
+
+template<class S>
+bool MmapDimacsParser<S>::parse_lits_until_zero(std::vector<CMSat::Lit>& out)
+{
+    out.clear();
+    while(true) {
+        int64_t v;
+        skip_space();
+        if (p >= end || *p == '\n') return error("Line ended without a terminating 0");
+        if (!parse_int(v)) return false;
+        if (v == 0) break;
+        const uint64_t var = std::abs(v)-1;
+        if (var >= hdr_vars) {
+            return error("Variable requested is larger than the header told us. Var: "
+                + std::to_string(var+1) + " header: " + std::to_string(hdr_vars));
+        }
+        out.push_back(CMSat::Lit(var, v < 0));
+    }
+    return true;
+}
+
+template<class S>
+bool MmapDimacsParser<S>::parse_header()
+{
+    if (header_found) return error("Multiple 'p cnf' headers");
+    p++;
+    skip_space();
+    if (!match("cnf")) return error("Header must be 'p cnf VARS CLAUSES'");
+    int64_t vars, cls;
+    if (!parse_int(vars) || !parse_int(cls)) return false;
+    if (vars < 0 || vars > std::numeric_limits<int32_t>::max() || cls < 0)
+        return error("Header has invalid numbers");
+    header_found = true;
+    hdr_vars = vars;
+    if (solver->nVars() < hdr_vars) solver->new_vars(hdr_vars - solver->nVars());
+    skip_line();
+    return true;
+}
+
+template<class S>
+bool MmapDimacsParser<S>::parse_comment()
+{
+    p++;
+    skip_space();
+    if (match("ind ") || match("p show ")) {
+        if (!header_found) return error("Projection set before the header");
+        if (!parse_lits_until_zero(lits)) return false;
+        for(const auto& l: lits) sampl_vars.push_back(l.var());
+        got_ind = true;
+    } else if (match("red ")) {
+        return parse_red_clause();
+    } else if (match("p weight ")) {
+        // "c p weight LIT WEIGHT", optionally followed by a 0
+        if (!header_found) return error("Weight before the header");
+        int64_t v;
+        if (!parse_int(v)) return false;
+        const uint64_t var = std::abs(v)-1;
+        if (v == 0 || var >= hdr_vars) return error("Weight line has an invalid literal");
+        skip_space();
+        const char* from = p;
+        while(p < end && *p != '\n' && *p != ' ' && *p != '\t' && *p != '\r') p++;
+        // Copied, strtod() could read past the end of the mapping
+        const std::string w_str(from, p);
+        char* w_end;
+        const double w = strtod(w_str.c_str(), &w_end);
+        if (w_str.empty() || *w_end != 0) return error("Weight is not a number: '" + w_str + "'");
+        skip_space();
+        if (p < end && *p != '\n') {
+            int64_t zero;
+            if (!parse_int(zero) || zero != 0) return error("Only a 0 may follow the weight");
+        }
+        if (solver->get_weighted()) solver->set_lit_weight(CMSat::Lit(var, v < 0), w);
+    } else if (match("MUST MULTIPLY BY ")) {
+        skip_space();
+        const char* from = p;
+        while(p < end && *p != '\n' && *p != ' ' && *p != '\r') p++;
+        solver->set_multiplier_weight(mpz_class(std::string(from, p)));
+    }
+    skip_line();
+    return true;
+}
+
+// "c red" clauses are one per comment line
+template<class S>
+bool MmapDimacsParser<S>::parse_red_clause()
+{
+    if (!header_found) return error("Clause before the 'p cnf' header");
+    if (!parse_lits_until_zero(lits)) return false;
+    solver->add_red_clause(lits);
+    skip_line();
+    return true;
+}
+
+template<class S>
+bool MmapDimacsParser<S>::parse()
+{
+    Chunk c;
+    pending.clear();
+    for(const char* from = data; from < end; ) {
+        const char* to = chunk_end(from, seq_chunk_sz);
+        c.clear();
+        tokenize(from, to, c);
+        if (!merge(c)) return false;
+        from = to;
+    }
+    return finish();
+}
+
+template<class S>
+bool MmapDimacsParser<S>::finish()
+{
+    if (!pending.empty()) return error_no_line("Last clause has no terminating 0");
+    if (got_ind) solver->set_sampl_vars(sampl_vars);
+    return true;
+}
+
+// Header and comment lines found by tokenize()
+template<class S>
+bool MmapDimacsParser<S>::parse_lines()
+{
+    while(true) {
+        skip_space();
+        if (p >= end) break;
+        switch(*p) {
+            case '\n': p++; break;
+            case 'p': if (!parse_header()) return false; break;
+            case 'c': if (!parse_comment()) return false; break;
+            case 'x': return error("XOR clauses are not supported");
+            default: return error(std::string("Unexpected character: '") + *p + "'");
+        }
+    }
+    return true;
+}
+
+// Clauses may span lines, and a line may hold more clauses, like with
+// DimacsParser. Anything not starting with a literal runs to the end of the
+// line, and is left for merge().
+template<class S>
+void MmapDimacsParser<S>::tokenize(const char* from, const char* to, Chunk& c) const
+{
+    const char* q = from;
+    while(q < to) {
+        while(q < to && (*q == ' ' || *q == '\t' || *q == '\r' || *q == '\n')) q++;
+        if (q >= to) break;
+        if (*q != '-' && *q != '+' && (*q < '0' || *q > '9')) {
+            // Header or comment line, left for merge()
+            const void* nl = memchr(q, '\n', to-q);
+            const char* line_end = nl ? (const char*)nl + 1 : to;
+            c.lines.push_back({c.toks.size(), q, line_end});
+            q = line_end;
+            continue;
+        }
+        int64_t v;
+        if (!read_int(q, to, v) || v > std::numeric_limits<int32_t>::max()
+                || v < -std::numeric_limits<int32_t>::max()) {
+            c.err_at = q;
+            c.err = "Expected a literal";
+            return;
+        }
+        c.toks.push_back(v);
+    }
+}
+
+template<class S>
+bool MmapDimacsParser<S>::merge(const Chunk& c)
+{
+    size_t at_line = 0;
+    for(size_t i = 0; i <= c.toks.size(); i++) {
+        while(at_line < c.lines.size() && c.lines[at_line].at == i) {
+            const auto& l = c.lines[at_line++];
+            const char* saved_end = end;
+            p = l.from;
+            end = l.to;
+            const bool ok = parse_lines();
+            end = saved_end;
+            if (!ok) return false;
+        }
+        if (i == c.toks.size()) break;
+
+        if (!header_found) return error_no_line("Clause before the 'p cnf' header");
+        const int32_t v = c.toks[i];
+        if (v == 0) {
+            solver->add_clause(pending);
+            pending.clear();
+            continue;
+        }
+        const uint32_t var = std::abs(v)-1;
+        if (var >= hdr_vars) {
+            return error_no_line("Variable requested is larger than the header told us. Var: "
+                + std::to_string(var+1) + " header: " + std::to_string(hdr_vars));
+        }
+        pending.push_back(CMSat::Lit(var, v < 0));
+    }
+    if (c.err_at) {
+        p = c.err_at;
+        return error(c.err);
+    }
+    return true;
+}
+
+template<class S>
+bool MmapDimacsParser<S>::parse_par(const uint32_t num_threads)
+{
+    // Chunk boundaries are moved to just after a newline, so no token is cut
+    std::vector<const char*> bounds;
+    bounds.push_back(data);
+    const size_t chunk_sz = std::max<size_t>(sz/num_threads, 1);
+    for(uint32_t i = 1; i < num_threads; i++) bounds.push_back(chunk_end(bounds.back(), chunk_sz));
+    bounds.push_back(end);
+
+    std::vector<Chunk> chunks(num_threads);
+    std::vector<std::thread> threads;
+    for(uint32_t i = 0; i < num_threads; i++) {
+        threads.push_back(std::thread([&, i]() { tokenize(bounds[i], bounds[i+1], chunks[i]); }));
+    }
+    for(auto& t: threads) t.join();
+
+    pending.clear();
+    for(auto& c: chunks) {
+        if (!merge(c)) return false;
+        c = Chunk();
+    }
+    return finish();
+}
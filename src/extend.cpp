@@ -26,6 +26,9 @@
 #include <algorithm>
 #include <set>
 #include <map>
+#include <atomic>
+#include <mutex>
+#include <thread>
 
 using namespace ArjunInt;
 
@@ -40,49 +43,17 @@ void Common::fill_assumptions_extend(
     //Add known independent as assumptions
     for(const auto& var: indep) {
         assert(var < orig_num_vars);
-        uint32_t indic = var_to_indic[var];
+        uint32_t indic = get_indic(var);
         assumptions.push_back(Lit(indic, false));
         verb_print(5, "Filled assump with indep: " << var);
     }
     verb_print(5, "Filling assumps END, total assumps size: " << assumptions.size());
 }
 
-void Common::add_all_indics()
-{
-    vector<Lit> tmp;
-    for(uint32_t var = 0; var < orig_num_vars; var++) {
-        // Already has an indicator variable
-        if (var_to_indic[var] != var_Undef) continue;
-        if (solver->removed_var(var)) continue;
-
-        solver->new_var();
-        uint32_t this_indic = solver->nVars()-1;
-        //torem_orig.push_back(Lit(this_indic, false));
-        var_to_indic[var] = this_indic;
-        dont_elim.push_back(Lit(this_indic, false));
-        indic_to_var.resize(this_indic+1, var_Undef);
-        indic_to_var[this_indic] = var;
-
-        // Below two mean var == (var+orig) in case indic is TRUE
-        tmp.clear();
-        tmp.push_back(Lit(var,               false));
-        tmp.push_back(Lit(var+orig_num_vars, true));
-        tmp.push_back(Lit(this_indic,        true));
-        solver->add_clause(tmp);
-
-        tmp.clear();
-        tmp.push_back(Lit(var,               true));
-        tmp.push_back(Lit(var+orig_num_vars, false));
-        tmp.push_back(Lit(this_indic,        true));
-        solver->add_clause(tmp);
-    }
-}
-
 void Common::extend_round()
 {
     assert(already_duplicated);
     solver->set_verbosity(0);
-    add_all_indics();
 
     for(const auto& x: seen) assert(x == 0);
     double start_round_time = cpuTimeTotal();
@@ -101,8 +72,15 @@ void Common::extend_round()
 
     sort_unknown(unknown);
     verb_print(1,"[arjun] Start unknown size: " << unknown.size());
+    if (conf.num_threads > 1) {
+        extend_round_par(indep, unknown);
+        return;
+    }
 
-    vector<Lit> assumptions;
+    // Only grows at the end, consecutive queries share all but the test lits
+    AssumpStack as;
+    fill_assumptions_extend(as.lits, indep);
+    as.num_indep = as.lits.size();
     uint32_t iter = 0;
 
     //Calc mod:
@@ -117,24 +95,40 @@ void Common::extend_round()
     uint32_t ret_false = 0;
     uint32_t ret_true = 0;
     uint32_t ret_undef = 0;
-    while(!unknown.empty()) {
+    uint32_t max_confl = initial_backw_budget();
+    vector<uint32_t> retry; // timed out with max_confl, in order of testing
+    // Here "indep" is the extended set, and "not_indep" the vars not defined by it
+    RoundStatus status("extend", unknown.size());
+    const uint64_t start_confl = solver->get_sum_conflicts();
+    auto update_status = [&]() {
+        status.set(iter, unknown.size(), indep.size(), status.ret_true);
+        status.conflicts = solver->get_sum_conflicts() - start_confl;
+    };
+    while(true) {
+        if (unknown.empty()) {
+            if (retry.empty() || !escalate_backw_budget(max_confl, start_round_time)) break;
+            unknown.assign(retry.rbegin(), retry.rend());
+            verb_print(1, "[arjun] re-testing " << retry.size()
+                << " timed out vars with max confl: " << max_confl);
+            retry.clear();
+        }
         uint32_t test_var = unknown.back();
         unknown.pop_back();
 
         assert(test_var < orig_num_vars);
         verb_print(5, "Testing: " << test_var);
 
-        //Assumption filling
         assert(test_var != var_Undef);
-        fill_assumptions_extend(assumptions, indep);
-        assumptions.push_back(Lit(test_var, false));
-        assumptions.push_back(Lit(test_var + orig_num_vars, true));
+        as.lits.push_back(Lit(test_var, false));
+        as.lits.push_back(Lit(test_var + orig_num_vars, true));
 
         solver->set_no_confl_needed();
 
         lbool ret = l_Undef;
-        solver->set_max_confl(conf.backw_max_confl);
-        ret = solver->solve(&assumptions);
+        solver->set_max_confl(max_confl);
+        ret = solver->solve(&as.lits);
+        as.pop_test(2);
+        status.add_ret(ret);
         if (ret == l_False) {
             ret_false++;
             verb_print(5, "[arjun] extend solve(): False");
@@ -149,11 +143,13 @@ void Common::extend_round()
         if (ret == l_Undef) {
             // Timed out, we'll treat is as unknown
             assert(test_var < orig_num_vars);
+            if (max_confl < conf.backw_max_confl) retry.push_back(test_var);
         } else if (ret == l_True) {
             // Not fully dependent
         } else if (ret == l_False) {
             // Dependent fully on `indep`
             indep.push_back(test_var);
+            as.add_indep(Lit(get_indic(test_var), false));
         }
 
         if (iter % mod == (mod-1) && conf.verb) {
@@ -179,12 +175,133 @@ void Common::extend_round()
             my_time = cpuTime();
         }
         iter++;
-
+        if (status_due(status)) {
+            update_status();
+            write_status(status);
+        }
     }
     sampling_set = indep;
+    update_status();
+    write_status(status, true);
 
     verb_print(1, "[arjun] extend round finished "
             << " final size: " << indep.size()
+            << " indicators: " << num_indics
             << " T: " << std::setprecision(2) << std::fixed << (cpuTime() - start_round_time));
     if (conf.verb >= 2) solver->print_stats();
 }
+
+// Every var found to be defined by the current set is defined by the original
+// sampling set, so workers can use any prefix of the list of newly defined
+// vars. The list is append-only: a slot is reserved with fetch_add and becomes
+// visible once its var is stored. Readers fold in slots until the first empty
+// one.
+void Common::extend_round_par(const vector<uint32_t>& indep, const vector<uint32_t>& unknown)
+{
+    double start_round_time = real_time_sec();
+    // Workers share var_to_indic read-only, and need the clauses. Vars found
+    // to be defined get their indicator in each worker's own solver.
+    add_all_indics(indep);
+    const auto cnf = get_init_cnf();
+
+    vector<std::atomic<uint32_t>> published(unknown.size());
+    for(auto& p: published) p.store(var_Undef, std::memory_order_relaxed);
+    std::atomic<uint32_t> num_published(0);
+    std::atomic<uint32_t> next(0);
+    std::atomic<uint32_t> ret_false(0);
+    std::atomic<uint32_t> ret_true(0);
+    std::atomic<uint32_t> ret_undef(0);
+    std::mutex print_mu; // also protects `status`
+    std::mutex status_mu; // so only one thread writes the status file
+    RoundStatus status("extend", unknown.size());
+
+    uint32_t mod = 1;
+    if (unknown.size() > 20 ) {
+        uint32_t will_do_iters = unknown.size();
+        uint32_t want_printed = 30;
+        mod = will_do_iters/want_printed;
+        mod = std::max<int>(mod, 1);
+    }
+
+    auto worker = [&]() {
+        SATSolver* s = new_solver_copy(cnf);
+        vector<Lit> assumptions;
+        for(const auto& v: indep) assumptions.push_back(Lit(var_to_indic[v], false));
+        uint32_t folded = 0;
+        uint64_t last_confl = 0;
+        while(true) {
+            const uint32_t at = next.fetch_add(1);
+            if (at >= unknown.size()) break;
+            const uint32_t test_var = unknown[unknown.size()-1-at];
+
+            while(folded < published.size()) {
+                const uint32_t v = published[folded].load(std::memory_order_acquire);
+                if (v == var_Undef) break;
+                assumptions.push_back(Lit(new_indic(s, v), false));
+                folded++;
+            }
+
+            assumptions.push_back(Lit(test_var, false));
+            assumptions.push_back(Lit(test_var + orig_num_vars, true));
+            s->set_no_confl_needed();
+            s->set_max_confl(conf.backw_max_confl);
+            const lbool ret = s->solve(&assumptions);
+            assumptions.resize(assumptions.size()-2);
+            {
+                // The counters are copied under the lock, the file is written after it
+                std::unique_lock<std::mutex> lk(print_mu);
+                status.add_ret(ret);
+                status.conflicts += s->get_sum_conflicts() - last_confl;
+                last_confl = s->get_sum_conflicts();
+                if (status_due(status)) {
+                    status.set(at+1, unknown.size() - std::min<size_t>(at+1, unknown.size()),
+                        indep.size() + num_published, status.ret_true);
+                    status.last_written = real_time_sec(); // so others don't write too
+                    RoundStatus snap = status;
+                    lk.unlock();
+                    std::lock_guard<std::mutex> slk(status_mu);
+                    write_status(snap);
+                }
+            }
+
+            if (ret == l_False) {
+                // Dependent fully on the extended set
+                published[num_published.fetch_add(1)].store(test_var, std::memory_order_release);
+                ret_false++;
+            } else if (ret == l_True) {
+                ret_true++;
+            } else {
+                ret_undef++;
+            }
+
+            if (at % mod == (mod-1) && conf.verb) {
+                std::lock_guard<std::mutex> lk(print_mu);
+                std::stringstream ss;
+                ss << ret_true << "/" << ret_false << "/" << ret_undef;
+                cout
+                << "c [arjun] iter: " << std::setw(5) << at
+                << " T/F/U: " << std::setw(10) << std::left << ss.str() << std::right
+                << " by: " << std::setw(3) << conf.num_threads
+                << " U: " << std::setw(7) << (unknown.size() - std::min<size_t>(at, unknown.size()))
+                << " I: " << std::setw(7) << indep.size() + num_published
+                << " T: " << std::setprecision(2) << std::fixed << (real_time_sec() - start_round_time)
+                << endl;
+            }
+        }
+        delete s;
+    };
+
+    vector<std::thread> threads;
+    for(uint32_t i = 0; i < conf.num_threads; i++) threads.push_back(std::thread(worker));
+    for(auto& t: threads) t.join();
+
+    sampling_set = indep;
+    for(uint32_t i = 0; i < num_published; i++) sampling_set.push_back(published[i].load());
+    status.set(unknown.size(), 0, sampling_set.size(), status.ret_true);
+    write_status(status, true);
+
+    verb_print(1, "[arjun] parallel extend round finished "
+            << " final size: " << sampling_set.size()
+            << " threads: " << conf.num_threads
+            << " wall T: " << std::setprecision(2) << std::fixed << (real_time_sec() - start_round_time));
+}
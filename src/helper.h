@@ -24,11 +24,16 @@
 
 #pragma once
 
+#include <algorithm>
 #include <cstdint>
+#include <iomanip>
 #include <iostream>
 #include <vector>
 #include <fstream>
+#include <sstream>
+#include <stdexcept>
 #include <string>
+#include <thread>
 #include <cryptominisat5/dimacsparser.h>
 #include <cryptominisat5/solvertypesmini.h>
 #ifdef USE_ZLIB
@@ -36,6 +41,10 @@
 #endif
 
 #include "arjun.h"
+#include "time_mem.h"
+#include "dimacs_mmap.h"
+#include "simpcnf_bin.h"
+#include "out_file.h"
 
 using std::vector;
 using namespace ArjunNS;
@@ -53,50 +62,222 @@ inline double stats_line_percent(double num, double total)
     }
 }
 
-inline void write_simpcnf(const ArjunNS::SimplifiedCNF& simpcnf,
-        const std::string& fname, bool red = true)
+// Appends `v` in decimal, without going through a stream
+inline void append_uint(std::string& out, uint64_t v)
+{
+    char tmp[20];
+    uint32_t n = 0;
+    do {
+        tmp[n++] = '0' + v % 10;
+        v /= 10;
+    } while(v);
+    while(n) out.push_back(tmp[--n]);
+}
+
+// Same text as `operator<<` on the clause, then " 0"
+template<class C>
+inline void append_clause(std::string& out, const char* prefix, const C& cl)
+{
+    out += prefix;
+    for(uint32_t i = 0; i < cl.size(); i++) {
+        if (i) out.push_back(' ');
+        if (cl[i].sign()) out.push_back('-');
+        append_uint(out, cl[i].var()+1);
+    }
+    out += " 0\n";
+}
+
+// Compressed if the file name ends in .gz or .zst, see OutFile
+class SimpCNFWriter {
+public:
+    SimpCNFWriter(const std::string& fname) : out(fname) {}
+    // Whatever is not written by close() is lost
+    std::string buf;
+    void maybe_flush() { if (buf.size() > (4U << 20)) flush(); }
+    void flush() {
+        out.write(std::move(buf));
+        buf = std::string();
+    }
+    void close() {
+        flush();
+        out.close();
+    }
+    bool seekable() const { return out.seekable(); }
+    void overwrite(const long pos, const std::string& data) {
+        flush();
+        out.overwrite(pos, data);
+    }
+
+    // Clauses are formatted in blocks, `num_threads` blocks at a time, and
+    // written in order, so the output does not depend on the thread count
+    void clauses(const ArjunNS::FlatClauses& cls, const char* prefix, const uint32_t num_threads) {
+        const size_t block = 1U << 16;
+        if (num_threads <= 1 || cls.size() < 2*block) {
+            for(const auto& cl: cls) {
+                append_clause(buf, prefix, cl);
+                maybe_flush();
+            }
+            return;
+        }
+        flush();
+        vector<std::string> outs(num_threads);
+        for(size_t at = 0; at < cls.size(); at += block*num_threads) {
+            vector<std::thread> threads;
+            for(uint32_t t = 0; t < num_threads; t++) {
+                threads.push_back(std::thread([&, t]() {
+                    outs[t].clear();
+                    const size_t from = std::min(at + t*block, cls.size());
+                    const size_t to = std::min(from + block, cls.size());
+                    for(size_t i = from; i < to; i++) append_clause(outs[t], prefix, cls[i]);
+                }));
+            }
+            for(auto& th: threads) th.join();
+            for(auto& o: outs) out.write(std::move(o));
+        }
+    }
+
+private:
+    OutFile out;
+};
+
+// `num_cls` padded with spaces to the width of any uint64_t
+inline std::string padded_cls_count(const uint64_t num_cls)
+{
+    std::string s;
+    append_uint(s, num_cls);
+    s.resize(20, ' ');
+    return s;
+}
+
+// Header and projection of write_simpcnf(). With `pad`, the clause count is
+// padded so it can be overwritten later. Returns where the count is in `b`
+inline size_t append_simpcnf_header(std::string& b,
+        const ArjunNS::SimplifiedCNF& simpcnf, const uint64_t num_cls, const bool pad = false)
 {
-    uint32_t num_cls = simpcnf.cnf.size();
-    std::ofstream outf;
-    outf.open(fname.c_str(), std::ios::out);
-    outf << "p cnf " << simpcnf.nvars << " " << num_cls << endl;
+    b += "p cnf ";
+    append_uint(b, simpcnf.nvars);
+    b += " ";
+    const size_t cls_at = b.size();
+    if (pad) b += padded_cls_count(num_cls);
+    else append_uint(b, num_cls);
+    b += "\n";
 
     //Add projection
-    outf << "c p show ";
+    b += "c p show ";
     auto sampl = simpcnf.sampl_vars;
     std::sort(sampl.begin(), sampl.end());
     for(const auto& v: sampl) {
         assert(v < simpcnf.nvars);
-        outf << v+1  << " ";
+        append_uint(b, v+1);
+        b += " ";
     }
-    outf << "0\n";
-    outf << "c p optshow ";
+    b += "0\n";
+    b += "c p optshow ";
     sampl = simpcnf.opt_sampl_vars;
     std::sort(sampl.begin(), sampl.end());
     for(const auto& v: sampl) {
         assert(v < simpcnf.nvars);
-        outf << v+1  << " ";
+        append_uint(b, v+1);
+        b += " ";
     }
-    outf << "0\n";
+    b += "0\n";
+    return cls_at;
+}
 
-    for(const auto& cl: simpcnf.cnf) outf << cl << " 0\n";
-    if (red) for(const auto& cl: simpcnf.red_cnf) outf << "c red " << cl << " 0\n";
+// "c p weight LIT WEIGHT" lines, `weights` maps Lit-s to doubles
+template<class W>
+inline void append_weights(std::string& b, const W& weights)
+{
+    std::stringstream ss;
+    for(const auto& it: weights) ss << "c p weight " << it.first << " " << it.second << "\n";
+    b += ss.str();
+}
 
+// Weights and multiplier, after the clauses
+inline void append_simpcnf_trailer(std::string& b, const ArjunNS::SimplifiedCNF& simpcnf)
+{
 #ifdef WEIGHTED
-    if (simpcnf.weighted) {
-        for(const auto& it: simpcnf.weights) {
-            outf << "c p weight " << it.first << " " << it.second << endl;
-        }
-    }
+    if (simpcnf.weighted) append_weights(b, simpcnf.weights);
 #endif
-    mpz_class w = simpcnf.multiplier_weight;
-    outf << "c MUST MULTIPLY BY " << w << endl;
+    std::stringstream ss;
+    mpz_class m = simpcnf.multiplier_weight;
+    ss << "c MUST MULTIPLY BY " << m << "\n";
+    b += ss.str();
 }
 
-inline void read_in_a_file(const std::string& filename,
-        Arjun* arjun,
-        const bool recompute_sampling_set,
-        bool& indep_support_given)
+inline void write_simpcnf(const ArjunNS::SimplifiedCNF& simpcnf,
+        const std::string& fname, bool red = true, const uint32_t num_threads = 1)
+{
+    SimpCNFWriter w(fname);
+    append_simpcnf_header(w.buf, simpcnf, simpcnf.cnf.size());
+    w.clauses(simpcnf.cnf, "", num_threads);
+    if (red) w.clauses(simpcnf.red_cnf, "c red ", num_threads);
+    append_simpcnf_trailer(w.buf, simpcnf);
+    w.close();
+}
+
+// Writes the same file as write_simpcnf(), for
+// Arjun::stream_fully_simplified_renumbered_cnf(). The clause count of a plain
+// file is padded with spaces and filled in at the end. Compressed files cannot
+// be patched, so they get the count up-front.
+class SimpCNFFileSink : public ArjunNS::SimplifiedCNFSink {
+public:
+    SimpCNFFileSink(const std::string& fname) : w(fname) {}
+    bool counts_first() const override { return !w.seekable(); }
+    void header(const ArjunNS::SimplifiedCNF& _meta, uint64_t num_cls, uint64_t) override {
+        meta = _meta;
+        // Nothing is flushed yet, so the position in the buffer is the file's
+        assert(w.buf.empty());
+        cls_at = append_simpcnf_header(w.buf, meta, num_cls, !counts_first());
+    }
+    void clause(const vector<Lit>& cl, bool red) override {
+        append_clause(w.buf, red ? "c red " : "", cl);
+        w.maybe_flush();
+    }
+    void done(uint64_t num_cls, uint64_t) override {
+        append_simpcnf_trailer(w.buf, meta);
+        if (!counts_first()) w.overwrite(cls_at, padded_cls_count(num_cls));
+        w.close();
+    }
+
+private:
+    SimpCNFWriter w;
+    ArjunNS::SimplifiedCNF meta;
+    size_t cls_at = 0;
+};
+
+// Phase names and count names are fixed identifiers, no escaping needed.
+// Throws std::runtime_error if the file cannot be written.
+inline void write_stats_json(const std::string& fname,
+        const vector<ArjunNS::PhaseStats>& phases)
+{
+    std::ofstream f(fname);
+    if (!f) throw std::runtime_error("Could not open file '" + fname + "' for writing");
+    double wall = 0, cpu = 0;
+    uint64_t peak_rss = 0;
+    f << std::fixed << std::setprecision(4);
+    f << "{\n  \"phases\": [";
+    for(size_t i = 0; i < phases.size(); i++) {
+        const auto& p = phases[i];
+        f << (i ? "," : "") << "\n    {\"name\": \"" << p.name << "\""
+          << ", \"wall_time\": " << p.wall_time
+          << ", \"cpu_time\": " << p.cpu_time
+          << ", \"peak_rss\": " << p.peak_rss;
+        for(const auto& c: p.counts) f << ", \"" << c.first << "\": " << c.second;
+        f << "}";
+        wall += p.wall_time;
+        cpu += p.cpu_time;
+        peak_rss = std::max(peak_rss, p.peak_rss);
+    }
+    f << "\n  ],\n"
+      << "  \"sum\": {\"wall_time\": " << wall
+      << ", \"cpu_time\": " << cpu
+      << ", \"peak_rss\": " << peak_rss << "}\n}\n";
+    if (!f) throw std::runtime_error("Could not write to file '" + fname + "'");
+}
+
+// Handles compressed input, and is the fallback when mmap() is not possible
+inline void read_in_a_file_stream(const std::string& filename, Arjun* arjun)
 {
     #ifndef USE_ZLIB
     FILE * in = fopen(filename.c_str(), "rb");
@@ -107,24 +288,61 @@ inline void read_in_a_file(const std::string& filename,
     #endif
 
     if (in == nullptr) {
-        std::cerr
-        << "ERROR! Could not open file '"
-        << filename
-        << "' for reading: " << strerror(errno) << endl;
-
-        std::exit(-1);
+        throw std::runtime_error("Could not open file '" + filename + "' for reading: "
+            + strerror(errno));
     }
 
-    if (!parser.parse_DIMACS(in, true)) exit(-1);
+    const bool ok = parser.parse_DIMACS(in, true);
+    #ifndef USE_ZLIB
+        fclose(in);
+    #else
+        gzclose(in);
+    #endif
+    if (!ok) throw std::runtime_error("Could not parse file '" + filename + "'");
+}
+
+// Throws std::runtime_error if the file cannot be read or parsed. The DIMACS
+// parsers print the details of a parse error themselves.
+inline void read_in_a_file(const std::string& filename,
+        Arjun* arjun,
+        const bool recompute_sampling_set,
+        bool& indep_support_given,
+        const uint32_t verb = 0,
+        const bool use_mmap = true,
+        const uint32_t parse_threads = 1)
+{
+    const double parse_time = real_time_sec();
+    MmapDimacsParser<ArjunNS::Arjun> mparser(arjun);
+    if (is_simpcnf_bin_file(filename)) {
+        read_simpcnf_bin(filename, arjun);
+        if (verb >= 1) {
+            cout << "c [arjun] parsed binary CNF T: " << std::fixed
+                << std::setprecision(2) << (real_time_sec() - parse_time) << endl;
+        }
+    } else if (use_mmap && mparser.map(filename)) {
+        // Not worth the threads for small files
+        const bool par = parse_threads > 1 && mparser.size() > 16*1024*1024;
+        if (!(par ? mparser.parse_par(parse_threads) : mparser.parse()))
+            throw std::runtime_error("Could not parse file '" + filename + "'");
+        if (verb >= 1) {
+            const double t = std::max(real_time_sec() - parse_time, 1e-6);
+            const double mb = mparser.size()/(1024.0*1024.0);
+            cout << "c [arjun] parsed " << std::fixed << std::setprecision(1) << mb << " MB with mmap"
+                << " threads: " << (par ? parse_threads : 1)
+                << " MB/s: " << mb/t
+                << " T: " << std::setprecision(2) << t << endl;
+        }
+    } else {
+        read_in_a_file_stream(filename, arjun);
+        if (verb >= 1) {
+            cout << "c [arjun] parsed input with stream parser T: " << std::fixed
+                << std::setprecision(2) << (real_time_sec() - parse_time) << endl;
+        }
+    }
     if (!arjun->get_sampl_vars_set() || recompute_sampling_set) {
         arjun->start_with_clean_sampling_set();
         indep_support_given = false;
     } else {
         indep_support_given = true;
     }
-    #ifndef USE_ZLIB
-        fclose(in);
-    #else
-        gzclose(in);
-    #endif
 }
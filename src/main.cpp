@@ -26,8 +26,14 @@
 #include <cfenv>
 #endif
 
+#include <atomic>
+#include <cstdio>
+#include <fstream>
 #include <iostream>
 #include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <thread>
 #include <vector>
 #include <string>
 #ifdef USE_ZLIB
@@ -39,6 +45,7 @@
 #include "arjun.h"
 #include "config.h"
 #include "helper.h"
+#include "phase_stats.h"
 #include <cryptominisat5/dimacsparser.h>
 
 using std::cout;
@@ -48,12 +55,17 @@ using std::vector;
 using namespace CMSat;
 
 argparse::ArgumentParser program = argparse::ArgumentParser("arjun");
-double start_time;
 ArjunInt::Config conf;
-ArjunNS::Arjun* arjun = nullptr;
 string elimtofile;
 int recompute_sampling_set = 0;
-bool indep_support_given = false;
+int mmap_parse = true;
+int parse_threads = 1;
+string stats_json_fname;
+string batch_fname;
+string batch_summary_fname;
+int batch_jobs = 1;
+#define BATCH_OPTS "seed, verb, threads, backward, maxc, simp, probe, gates, " \
+    "compindep, extend, red, recomp, sbva, statsjson"
 
 uint32_t polar_mode = 0;
 SimpConf simp_conf;
@@ -93,6 +105,18 @@ void add_arjun_options()
         .action([&](const auto& a) {recompute_sampling_set = std::atoi(a.c_str());})
         .default_value(recompute_sampling_set)
         .help("Recompute sampling set even if it's part of the CNF");
+    program.add_argument("--mmap")
+        .action([&](const auto& a) {mmap_parse = std::atoi(a.c_str());})
+        .default_value(mmap_parse)
+        .help("Parse uncompressed input via mmap() instead of the stream parser");
+    program.add_argument("--parsethreads")
+        .action([&](const auto& a) {parse_threads = std::atoi(a.c_str());})
+        .default_value(parse_threads)
+        .help("Number of threads to parse large uncompressed inputs with mmap() on");
+    program.add_argument("--stats-json")
+        .action([&](const auto& a) {stats_json_fname = a;})
+        .default_value(stats_json_fname)
+        .help("Write wall/CPU time, memory and counts of each phase to this file as JSON");
     program.add_argument("--backward")
         .action([&](const auto& a) {conf.backward = std::atoi(a.c_str());})
         .default_value(conf.backward)
@@ -101,6 +125,36 @@ void add_arjun_options()
         .action([&](const auto& a) {conf.backw_max_confl = std::atoi(a.c_str());})
         .default_value(conf.backw_max_confl)
         .help("Maximum conflicts per variable in backward mode");
+    program.add_argument("--maxcstart")
+        .action([&](const auto& a) {conf.backw_confl_start = std::atoi(a.c_str());})
+        .default_value(conf.backw_confl_start)
+        .help("Start with this many conflicts per variable in backward and extend mode, "
+                "and re-test timed out variables with geometrically larger budgets, up to --maxc. "
+                "0 = always use --maxc");
+    program.add_argument("--maxcmult")
+        .action([&](const auto& a) {conf.backw_confl_mult = std::atof(a.c_str());})
+        .default_value(conf.backw_confl_mult)
+        .help("Conflict budget multiplier between passes, see --maxcstart");
+    program.add_argument("--maxbackwtime")
+        .action([&](const auto& a) {conf.backw_max_time = std::atof(a.c_str());})
+        .default_value(conf.backw_max_time)
+        .help("Don't start new passes over timed out variables after this many seconds. 0 = no limit");
+    program.add_argument("--threads")
+        .action([&](const auto& a) {conf.num_threads = std::max(std::atoi(a.c_str()), 1);})
+        .default_value(conf.num_threads)
+        .help("Number of threads for backward and extend mode. Each thread has its own copy of the duplicated CNF");
+    program.add_argument("--portfolio")
+        .action([&](const auto& a) {conf.portfolio = std::atoi(a.c_str());})
+        .default_value(conf.portfolio)
+        .help("Race this many variable orderings in backward mode, each on its own thread and copy of the duplicated CNF. Removed variables are shared between them. 0 = off");
+    program.add_argument("--portfoliotime")
+        .action([&](const auto& a) {conf.portfolio_time = std::atof(a.c_str());})
+        .default_value(conf.portfolio_time)
+        .help("Stop the portfolio after this many (wall clock) seconds and take the smallest set. 0 = run until one finishes");
+    program.add_argument("--group")
+        .action([&](const auto& a) {conf.backw_group_max = std::atoi(a.c_str());})
+        .default_value(conf.backw_group_max)
+        .help("Maximum number of variables tested together in backward mode. The block size adapts to how many variables turn out to be independent. 0 = test one at a time");
     program.add_argument("--extend")
         .action([&](const auto& a) {extend_indep = std::atoi(a.c_str());})
         .default_value(extend_indep)
@@ -256,97 +310,416 @@ void add_arjun_options()
                 "File must contain a variable on each line. "
                 "Variables start at ZERO. Variable from the BOTTOM will be removed FIRST. This is for DEBUG ONLY");
 
+    program.add_argument("--checkpoint")
+        .action([&](const auto& a) {conf.checkpoint_fname = a;})
+        .default_value(conf.checkpoint_fname)
+        .help("Periodically write the state of the backward round to this file. Only with --threads 1 and no --portfolio");
+    program.add_argument("--checkpointevery")
+        .action([&](const auto& a) {conf.checkpoint_every = std::atof(a.c_str());})
+        .default_value(conf.checkpoint_every)
+        .help("Write checkpoint every this many (wall clock) seconds");
+    program.add_argument("--resume")
+        .action([&](const auto& a) {conf.resume_fname = a;})
+        .default_value(conf.resume_fname)
+        .help("Continue the backward round from this checkpoint file. Refused unless it was written for the same input, sampling set, seed and preprocessing options");
+    program.add_argument("--status")
+        .action([&](const auto& a) {conf.status_fname = a;})
+        .default_value(conf.status_fname)
+        .help("Periodically rewrite this file with the progress of the backward/extend round, as JSON");
+    program.add_argument("--statusevery")
+        .action([&](const auto& a) {conf.status_every = std::atof(a.c_str());})
+        .default_value(conf.status_every)
+        .help("Rewrite status file every this many (wall clock) seconds");
+    program.add_argument("--gatecache")
+        .action([&](const auto& a) {conf.gate_cache_dir = a;})
+        .default_value(conf.gate_cache_dir)
+        .help("Directory of gate definitions found on earlier runs. Same formula and sampling set (in any clause order) reuses them instead of recovering gates again, new ones are added");
+
+    program.add_argument("--batch")
+        .action([&](const auto& a) {batch_fname = a;})
+        .default_value(batch_fname)
+        .help("Process every job of this manifest in this process. One job per line: "
+                "INPUT [OUTPUT] [option=value ...], where options are: " BATCH_OPTS
+                ". Lines starting with '#' are skipped");
+    program.add_argument("--batchjobs")
+        .action([&](const auto& a) {batch_jobs = std::atoi(a.c_str());})
+        .default_value(batch_jobs)
+        .help("Number of batch jobs run at the same time, each on its own thread");
+    program.add_argument("--batchsummary")
+        .action([&](const auto& a) {batch_summary_fname = a;})
+        .default_value(batch_summary_fname)
+        .help("Write one JSON line per finished batch job here. Default: MANIFEST.summary");
+
     program.add_argument("files").remaining().help("input file and output file");
 }
 
-void print_final_sampl_set(const vector<uint32_t>& sampl_vars) {
+// Everything one INPUT -> OUTPUT run is configured by. Taken from the command
+// line, batch jobs then override some of it.
+struct RunOpts {
+    ArjunInt::Config conf;
+    SimpConf simp_conf;
+    string inp;
+    string out;
+    string stats_json;
+    int recompute_sampling_set;
+    int mmap_parse;
+    int parse_threads;
+    int gates;
+    int compute_indep;
+    int extend_indep;
+    int redundant_cls;
+    int64_t sbva_steps;
+    int sbva_cls_cutoff;
+    int sbva_lits_cutoff;
+    int sbva_tiebreak;
+};
+
+RunOpts cmdline_opts() {
+    RunOpts o;
+    o.conf = conf;
+    o.simp_conf = simp_conf;
+    o.out = elimtofile;
+    o.stats_json = stats_json_fname;
+    o.recompute_sampling_set = recompute_sampling_set;
+    o.mmap_parse = mmap_parse;
+    o.parse_threads = std::max(parse_threads, 1);
+    o.gates = gates;
+    o.compute_indep = compute_indep;
+    o.extend_indep = extend_indep;
+    o.redundant_cls = redundant_cls;
+    o.sbva_steps = sbva_steps;
+    o.sbva_cls_cutoff = sbva_cls_cutoff;
+    o.sbva_lits_cutoff = sbva_lits_cutoff;
+    o.sbva_tiebreak = sbva_tiebreak;
+    return o;
+}
+
+// State of one run. Runs share nothing, so batch jobs can run on threads
+struct Run {
+    Run(const RunOpts& _o, const bool quiet) :
+        o(_o), log(quiet ? nullptr : cout.rdbuf()) {}
+    RunOpts o;
+    ArjunNS::Arjun* arjun = nullptr;
+    bool indep_support_given = false;
+    // Phases timed here, plus those of `arjun`, copied before it is deleted
+    vector<ArjunNS::PhaseStats> stats;
+    double start_time = 0;
+    size_t orig_sampl_size = 0;
+    size_t sampl_size = 0;
+    size_t empty_size = 0;
+    // Our own progress lines. Without a buffer (batch jobs) they are dropped
+    std::ostream log;
+};
+
+void delete_arjun(Run& r) {
+    if (!r.arjun) return;
+    const auto& s = r.arjun->get_stats();
+    r.stats.insert(r.stats.end(), s.begin(), s.end());
+    delete r.arjun;
+    r.arjun = nullptr;
+}
+
+void print_final_sampl_set(Run& r, const vector<uint32_t>& sampl_vars) {
     if (sampl_vars.size() < 100) {
-        cout << "c p show ";
-        for(const uint32_t s: sampl_vars) cout << s+1 << " ";
-        cout << "0" << endl;
+        r.log << "c p show ";
+        for(const uint32_t s: sampl_vars) r.log << s+1 << " ";
+        r.log << "0" << endl;
     } else {
-        cout << "c not printing indep set, it's more than 100 elements" << endl;
+        r.log << "c not printing indep set, it's more than 100 elements" << endl;
     }
 
-    cout
+    r.log
     << "c [arjun] final set size: " << std::setw(7) << sampl_vars.size()
     << " percent of original: " << std::setw(6) << std::setprecision(4)
-    << stats_line_percent(sampl_vars.size(), arjun->get_orig_sampl_vars().size()) << " %" << endl
+    << stats_line_percent(sampl_vars.size(), r.arjun->get_orig_sampl_vars().size()) << " %" << endl
 
-    << "c [arjun] empty occs: " << std::setw(7) << arjun->get_empty_sampl_vars().size()
+    << "c [arjun] empty occs: " << std::setw(7) << r.arjun->get_empty_sampl_vars().size()
     << " percent of original: " <<  std::setw(6) << std::setprecision(4)
-    << stats_line_percent(arjun->get_empty_sampl_vars().size(), arjun->get_orig_sampl_vars().size())
+    << stats_line_percent(r.arjun->get_empty_sampl_vars().size(), r.arjun->get_orig_sampl_vars().size())
     << " %" << endl;
 }
 
-void elim_to_file() {
+// Without SBVA and extension nothing needs the whole CNF in memory
+void elim_to_file_streaming(Run& r) {
+    double dump_start_time = cpuTime();
+    r.log << "c [arjun] streaming simplified problem to '" << r.o.out << "'" << endl;
+    if (is_simpcnf_bin_fname(r.o.out)) {
+        BinCNFFileSink sink(r.o.out);
+        r.arjun->stream_fully_simplified_renumbered_cnf(r.o.simp_conf, sink, !r.indep_support_given, r.o.redundant_cls);
+    } else {
+        SimpCNFFileSink sink(r.o.out);
+        r.arjun->stream_fully_simplified_renumbered_cnf(r.o.simp_conf, sink, !r.indep_support_given, r.o.redundant_cls);
+    }
+    delete_arjun(r);
+    r.log << "c [arjun] Dumping took: " << std::setprecision(2) << (cpuTime() - dump_start_time) << endl;
+    r.log << "c [arjun] All done. T: " << std::setprecision(2) << (cpuTime() - r.start_time) << endl;
+}
+
+void elim_to_file(Run& r) {
+    if (r.o.sbva_steps == 0 && !(r.indep_support_given && r.o.extend_indep)) {
+        elim_to_file_streaming(r);
+        return;
+    }
     double dump_start_time = cpuTime();
-    auto ret = arjun->get_fully_simplified_renumbered_cnf(simp_conf);
+    auto ret = r.arjun->get_fully_simplified_renumbered_cnf(r.o.simp_conf);
 
-    arjun->run_sbva(ret, sbva_steps, sbva_cls_cutoff, sbva_lits_cutoff, sbva_tiebreak);
+    r.arjun->run_sbva(ret, r.o.sbva_steps, r.o.sbva_cls_cutoff, r.o.sbva_lits_cutoff, r.o.sbva_tiebreak);
 
-    delete arjun; arjun = nullptr;
-    if (!indep_support_given) {
+    delete_arjun(r);
+    if (!r.indep_support_given) {
         assert(ret.opt_sampl_vars.empty());
         for(uint32_t i = 0; i < ret.nvars; i++) ret.opt_sampl_vars.push_back(i);
     } else {
-        if (extend_indep) {
+        if (r.o.extend_indep) {
             Arjun arj2;
             arj2.new_vars(ret.nvars);
-            arj2.set_verbosity(conf.verb);
+            arj2.set_verbosity(r.o.conf.verb);
+            arj2.set_num_threads(r.o.conf.num_threads);
             for(const auto& cl: ret.cnf) arj2.add_clause(cl);
             arj2.set_sampl_vars(ret.sampl_vars);
             ret.opt_sampl_vars = arj2.extend_sampl_set();
+            r.stats.insert(r.stats.end(), arj2.get_stats().begin(), arj2.get_stats().end());
         } else {
             ret.opt_sampl_vars = ret.sampl_vars;
         }
     }
 
-    ret.renumber_sampling_vars_for_ganak();
-    cout << "c [arjun] dumping simplified problem to '" << elimtofile << "'" << endl;
-    write_simpcnf(ret, elimtofile, redundant_cls);
-    cout << "c [arjun] Dumping took: " << std::setprecision(2) << (cpuTime() - dump_start_time) << endl;
-    cout << "c [arjun] All done. T: " << std::setprecision(2) << (cpuTime() - start_time) << endl;
+    {
+        PhaseTimer phase(r.stats, "renumber");
+        phase.count("lits", ret.cnf.num_lits() + ret.red_cnf.num_lits());
+        ret.renumber_sampling_vars_for_ganak(r.o.conf.num_threads);
+    }
+    r.log << "c [arjun] dumping simplified problem to '" << r.o.out << "'" << endl;
+    {
+        PhaseTimer phase(r.stats, "write");
+        phase.count("clauses", ret.cnf.size() + (r.o.redundant_cls ? ret.red_cnf.size() : 0));
+        if (is_simpcnf_bin_fname(r.o.out)) write_simpcnf_bin(ret, r.o.out, r.o.redundant_cls);
+        else write_simpcnf(ret, r.o.out, r.o.redundant_cls, r.o.conf.num_threads);
+    }
+    r.log << "c [arjun] Dumping took: " << std::setprecision(2) << (cpuTime() - dump_start_time) << endl;
+    r.log << "c [arjun] All done. T: " << std::setprecision(2) << (cpuTime() - r.start_time) << endl;
 }
 
-void set_config(ArjunNS::Arjun* arj) {
-    if (!compute_indep) {
-        gates = 0;
-        conf.backward = 0;
+void set_config(Run& r) {
+    ArjunNS::Arjun* arj = r.arjun;
+    if (!r.o.compute_indep) {
+        r.o.gates = 0;
+        r.o.conf.backward = 0;
     }
 
-    cout << "c [arjun] using seed: " << conf.seed << endl;
-    arj->set_verbosity(conf.verb);
-    arj->set_seed(conf.seed);
-    arj->set_fast_backw(conf.fast_backw);
-    arj->set_distill(conf.distill);
-    arj->set_specified_order_fname(conf.specified_order_fname);
-    arj->set_intree(conf.intree);
-    arj->set_bve_pre_simplify(conf.bve_pre_simplify);
-    arj->set_unknown_sort(conf.unknown_sort);
-    if (gates) {
-      arj->set_or_gate_based(conf.or_gate_based);
-      arj->set_ite_gate_based(conf.ite_gate_based);
-      arj->set_xor_gates_based(conf.xor_gates_based);
-      arj->set_irreg_gate_based(conf.irreg_gate_based);
+    r.log << "c [arjun] using seed: " << r.o.conf.seed << endl;
+    arj->set_verbosity(r.o.conf.verb);
+    arj->set_seed(r.o.conf.seed);
+    arj->set_fast_backw(r.o.conf.fast_backw);
+    arj->set_distill(r.o.conf.distill);
+    arj->set_specified_order_fname(r.o.conf.specified_order_fname);
+    arj->set_checkpoint_fname(r.o.conf.checkpoint_fname);
+    arj->set_checkpoint_every(r.o.conf.checkpoint_every);
+    arj->set_status_fname(r.o.conf.status_fname);
+    arj->set_status_every(r.o.conf.status_every);
+    arj->set_gate_cache_dir(r.o.conf.gate_cache_dir);
+    arj->set_resume_fname(r.o.conf.resume_fname);
+    arj->set_intree(r.o.conf.intree);
+    arj->set_bve_pre_simplify(r.o.conf.bve_pre_simplify);
+    arj->set_unknown_sort(r.o.conf.unknown_sort);
+    if (r.o.gates) {
+      arj->set_or_gate_based(r.o.conf.or_gate_based);
+      arj->set_ite_gate_based(r.o.conf.ite_gate_based);
+      arj->set_xor_gates_based(r.o.conf.xor_gates_based);
+      arj->set_irreg_gate_based(r.o.conf.irreg_gate_based);
     } else {
-      cout << "c NOTE: all gates are turned off due to `--gates 0`" << endl;
+      r.log << "c NOTE: all gates are turned off due to `--gates 0`" << endl;
       arj->set_or_gate_based   (0);
       arj->set_ite_gate_based  (0);
       arj->set_xor_gates_based (0);
       arj->set_irreg_gate_based(0);
     }
-    arj->set_no_gates_below(conf.no_gates_below);
-    arj->set_probe_based(conf.probe_based);
-    arj->set_backward(conf.backward);
-    arj->set_backw_max_confl(conf.backw_max_confl);
-    arj->set_gauss_jordan(conf.gauss_jordan);
-    arj->set_simp(conf.simp);
-    arj->set_bve_during_elimtofile(conf.bve_during_elimtofile);
+    arj->set_no_gates_below(r.o.conf.no_gates_below);
+    arj->set_probe_based(r.o.conf.probe_based);
+    arj->set_backward(r.o.conf.backward);
+    arj->set_backw_max_confl(r.o.conf.backw_max_confl);
+    arj->set_backw_confl_start(r.o.conf.backw_confl_start);
+    arj->set_backw_confl_mult(r.o.conf.backw_confl_mult);
+    arj->set_backw_max_time(r.o.conf.backw_max_time);
+    arj->set_num_threads(r.o.conf.num_threads);
+    arj->set_backw_group_max(r.o.conf.backw_group_max);
+    arj->set_portfolio(r.o.conf.portfolio);
+    arj->set_portfolio_time(r.o.conf.portfolio_time);
+    arj->set_gauss_jordan(r.o.conf.gauss_jordan);
+    arj->set_simp(r.o.conf.simp);
+    arj->set_bve_during_elimtofile(r.o.conf.bve_during_elimtofile);
+}
+
+// Parse, compute the independent set, and write the simplified CNF if asked to.
+// Throws std::runtime_error if the input can't be read, or the output or the
+// stats can't be written.
+void run(Run& r) {
+    r.start_time = cpuTime();
+    r.arjun = new ArjunNS::Arjun;
+    set_config(r);
+
+    {
+        PhaseTimer phase(r.stats, "parse");
+        read_in_a_file(r.o.inp, r.arjun, r.o.recompute_sampling_set, r.indep_support_given,
+                r.o.conf.verb, r.o.mmap_parse, r.o.parse_threads);
+        phase.count("vars", r.arjun->nVars());
+    }
+    vector<uint32_t> sampl_vars = r.arjun->run_backwards();
+
+    const auto& cnf = r.arjun->get_orig_cnf();
+    r.orig_sampl_size = cnf.sampl_vars.size();
+    r.sampl_size = sampl_vars.size();
+    r.empty_size = r.arjun->get_empty_sampl_vars().size();
+    r.log << "c [arjun] original sampling set size: " << cnf.sampl_vars.size() << endl;
+    print_final_sampl_set(r, sampl_vars);
+    r.log << "c [arjun] finished "
+        << "T: " << std::setprecision(2) << std::fixed << (cpuTime() - r.start_time) << endl;
+
+    if (!r.o.out.empty()) elim_to_file(r);
+
+    delete_arjun(r);
+    if (!r.o.stats_json.empty()) write_stats_json(r.o.stats_json, r.stats);
+}
+
+struct BatchJob {
+    RunOpts o;
+    string error; // set if the job can't be run
+};
+
+// One option=value of a manifest line, returns false if `key` is unknown
+bool apply_batch_opt(RunOpts& o, const string& key, const string& val) {
+    const char* v = val.c_str();
+    if (key == "seed") o.conf.seed = std::atoi(v);
+    else if (key == "verb") o.conf.verb = std::atoi(v);
+    else if (key == "threads") o.conf.num_threads = std::max(std::atoi(v), 1);
+    else if (key == "backward") o.conf.backward = std::atoi(v);
+    else if (key == "maxc") o.conf.backw_max_confl = std::atoi(v);
+    else if (key == "simp") o.conf.simp = std::atoi(v);
+    else if (key == "probe") o.conf.probe_based = std::atoi(v);
+    else if (key == "gates") o.gates = std::atoi(v);
+    else if (key == "compindep") o.compute_indep = std::atoi(v);
+    else if (key == "extend") o.extend_indep = std::atoi(v);
+    else if (key == "red") o.redundant_cls = std::atoi(v);
+    else if (key == "recomp") o.recompute_sampling_set = std::atoi(v);
+    else if (key == "sbva") o.sbva_steps = std::atoll(v);
+    else if (key == "statsjson") o.stats_json = val;
+    else return false;
+    return true;
+}
+
+vector<BatchJob> read_batch_manifest(const string& fname) {
+    std::ifstream in(fname);
+    if (!in) {
+        cout << "ERROR: cannot open batch manifest '" << fname << "'" << endl;
+        exit(-1);
+    }
+    RunOpts base = cmdline_opts();
+    // Jobs must not write the same files, and their output would interleave
+    base.out.clear();
+    base.stats_json.clear();
+    base.conf.checkpoint_fname.clear();
+    base.conf.resume_fname.clear();
+    base.conf.status_fname.clear();
+    if (!program.is_used("--verb")) base.conf.verb = 0;
+
+    vector<BatchJob> jobs;
+    string line;
+    while(std::getline(in, line)) {
+        std::istringstream ss(line);
+        string tok;
+        if (!(ss >> tok) || tok[0] == '#') continue;
+        BatchJob job;
+        job.o = base;
+        job.o.inp = tok;
+        bool have_out = false;
+        while(ss >> tok) {
+            const auto eq = tok.find('=');
+            if (eq == string::npos) {
+                if (have_out) job.error = "more than one output file given";
+                job.o.out = tok;
+                have_out = true;
+            } else if (!apply_batch_opt(job.o, tok.substr(0, eq), tok.substr(eq+1))) {
+                job.error = "unknown option '" + tok.substr(0, eq) + "'";
+            }
+        }
+        jobs.push_back(job);
+    }
+    return jobs;
+}
+
+string json_str(const string& s) {
+    string ret = "\"";
+    for(const char c: s) {
+        if (c == '"' || c == '\\') { ret += '\\'; ret += c; }
+        else if ((unsigned char)c < 0x20) {
+            char buf[8];
+            snprintf(buf, sizeof(buf), "\\u%04x", (unsigned)c);
+            ret += buf;
+        } else ret += c;
+    }
+    return ret + "\"";
+}
+
+// Jobs are handed out in manifest order to `batch_jobs` threads, each job
+// with its own Arjun. The summary gets a line as each job finishes.
+void run_batch() {
+    vector<BatchJob> jobs = read_batch_manifest(batch_fname);
+    const string summary_fname = batch_summary_fname.empty() ?
+        batch_fname + ".summary" : batch_summary_fname;
+    std::ofstream summary(summary_fname);
+    if (!summary) {
+        cout << "ERROR: cannot open batch summary file '" << summary_fname << "' for writing" << endl;
+        exit(-1);
+    }
+    const uint32_t num_workers = std::max<uint32_t>(1, std::min<size_t>(batch_jobs, jobs.size()));
+    cout << "c [arjun] batch jobs: " << jobs.size() << " threads: " << num_workers
+        << " summary: '" << summary_fname << "'" << endl;
+
+    const double start = real_time_sec();
+    std::mutex mu;
+    std::atomic<size_t> next(0);
+    uint32_t failed = 0;
+    auto worker = [&]() {
+        while(true) {
+            const size_t i = next.fetch_add(1);
+            if (i >= jobs.size()) return;
+            BatchJob& job = jobs[i];
+            const double job_start = real_time_sec();
+            Run r(job.o, job.o.conf.verb == 0);
+            if (job.error.empty()) {
+                try {
+                    run(r);
+                } catch (const std::exception& e) {
+                    // Also e.g. std::bad_alloc, one job must not end the batch
+                    job.error = e.what();
+                    delete_arjun(r);
+                }
+            }
+
+            std::lock_guard<std::mutex> lk(mu);
+            if (!job.error.empty()) failed++;
+            summary << std::fixed << std::setprecision(3)
+                << "{\"job\": " << i
+                << ", \"input\": " << json_str(r.o.inp)
+                << ", \"output\": " << json_str(r.o.out)
+                << ", \"ok\": " << (job.error.empty() ? "true" : "false")
+                << ", \"error\": " << json_str(job.error)
+                << ", \"orig_sampl\": " << r.orig_sampl_size
+                << ", \"sampl\": " << r.sampl_size
+                << ", \"empty\": " << r.empty_size
+                << ", \"wall_time\": " << real_time_sec() - job_start
+                << "}" << endl;
+        }
+    };
+    vector<std::thread> threads;
+    for(uint32_t i = 0; i < num_workers; i++) threads.push_back(std::thread(worker));
+    for(auto& t: threads) t.join();
+
+    cout << "c [arjun] batch finished. jobs: " << jobs.size() << " failed: " << failed
+        << " wall T: " << std::setprecision(2) << std::fixed << (real_time_sec() - start) << endl;
 }
 
 int main(int argc, char** argv) {
-    arjun = new ArjunNS::Arjun;
     #if defined(__GNUC__) && defined(__linux__)
     feenableexcept(FE_INVALID   | FE_DIVBYZERO | FE_OVERFLOW);
     #endif
@@ -376,17 +749,26 @@ int main(int argc, char** argv) {
     }
 
     if (program["version"] == true) {
-        cout << "c [arjun] SHA revision: " << arjun->get_version_info() << endl;
-        cout << "c [arjun] Compilation environment: " << arjun->get_compilation_env() << endl;
+        cout << "c [arjun] SHA revision: " << ArjunNS::Arjun::get_version_info() << endl;
+        cout << "c [arjun] Compilation environment: " << ArjunNS::Arjun::get_compilation_env() << endl;
         std::exit(0);
     }
 
-    cout << "c Arjun Version: " << arjun->get_version_info() << endl;
-    cout << arjun->get_solver_version_info();
+    // The threaded and portfolio backward rounds keep no checkpoint
+    if ((!conf.checkpoint_fname.empty() || !conf.resume_fname.empty())
+            && (conf.num_threads > 1 || conf.portfolio > 1)) {
+        cout << "ERROR: --checkpoint and --resume only work with --threads 1 and no --portfolio" << endl;
+        exit(-1);
+    }
+
+    cout << "c Arjun Version: " << ArjunNS::Arjun::get_version_info() << endl;
+    cout << ArjunNS::Arjun::get_solver_version_info();
     cout << "c executed with command line: " << command_line << endl;
 
-    start_time = cpuTime();
-    set_config(arjun);
+    if (!batch_fname.empty()) {
+        run_batch();
+        return 0;
+    }
 
     //parsing the input
     vector<std::string> files;
@@ -402,19 +784,15 @@ int main(int argc, char** argv) {
         exit(-1);
     }
 
-    const string inp = files[0];
-    if (files.size() >= 2) elimtofile = files[1];
-    read_in_a_file(inp, arjun, recompute_sampling_set, indep_support_given);
-    vector<uint32_t> sampl_vars = arjun->run_backwards();
-
-    const auto& cnf = arjun->get_orig_cnf();
-    cout << "c [arjun] original sampling set size: " << cnf.sampl_vars.size() << endl;
-    print_final_sampl_set(sampl_vars);
-    cout << "c [arjun] finished "
-        << "T: " << std::setprecision(2) << std::fixed << (cpuTime() - start_time) << endl;
-
-    if (!elimtofile.empty()) elim_to_file();
-
-    delete arjun;
+    RunOpts o = cmdline_opts();
+    o.inp = files[0];
+    if (files.size() >= 2) o.out = files[1];
+    Run r(o, false);
+    try {
+        run(r);
+    } catch (const std::runtime_error& e) {
+        cout << "ERROR: " << e.what() << endl;
+        exit(-1);
+    }
     return 0;
 }
@@ -0,0 +1,261 @@
+/*
+ Arjun
+
+ Copyright (c) 2019-2020, Mate Soos and Kuldeep S. Meel. All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cassert>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#ifdef USE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef USE_ZSTD
+#include <zstd.h>
+#endif
+
+// Output file taking whole buffers. Plain files are written directly. For
+// ".gz" and ".zst" the buffers are queued, and compressed and written on a
+// separate thread, so the caller can format the next buffer meanwhile.
+// Throws std::runtime_error if the file cannot be written.
+class OutFile
+{
+public:
+    enum class Compr {none, gz, zstd};
+
+    OutFile(const std::string& _fname) : fname(_fname) {
+        if (ends_with(".gz")) compr = Compr::gz;
+        else if (ends_with(".zst")) compr = Compr::zstd;
+
+        switch(compr) {
+            case Compr::none:
+                f = fopen(fname.c_str(), "wb");
+                if (!f) open_error();
+                break;
+            case Compr::gz:
+#ifdef USE_ZLIB
+                gz = gzopen(fname.c_str(), "wb6");
+                if (!gz) open_error();
+                break;
+#else
+                throw std::runtime_error(std::string("gzip output requested for '") + fname
+                    + "' but this build has no zlib support");
+#endif
+            case Compr::zstd:
+#ifdef USE_ZSTD
+                f = fopen(fname.c_str(), "wb");
+                if (!f) open_error();
+                zctx = ZSTD_createCCtx();
+                ZSTD_CCtx_setParameter(zctx, ZSTD_c_compressionLevel, 3);
+                zout.resize(ZSTD_CStreamOutSize());
+                break;
+#else
+                throw std::runtime_error(std::string("zstd output requested for '") + fname
+                    + "' but this build has no zstd support");
+#endif
+        }
+        if (compr != Compr::none) worker = std::thread([this]() { compress_loop(); });
+    }
+
+    // Errors cannot be reported from here, call close() for that
+    ~OutFile() { if (!closed) finish(); }
+
+    // Writes out what is still queued and closes the file, checking every
+    // step. Must be called once all data is written.
+    void close() {
+        const std::string e = finish();
+        if (!e.empty()) fail(e);
+    }
+
+    void write(std::string&& data) {
+        if (data.empty()) return;
+        assert(!closed);
+        if (compr == Compr::none) {
+            if (!raw_write(data.data(), data.size())) fail(write_msg());
+            return;
+        }
+        std::unique_lock<std::mutex> lk(mu);
+        // Bounded, so a slow compressor doesn't make us keep everything
+        cv.wait(lk, [&]() { return queue.size() < max_queued; });
+        // The compressor thread only records its errors, they are reported here
+        if (!err.empty()) {
+            const std::string e = err;
+            lk.unlock();
+            fail(e);
+        }
+        queue.push_back(std::move(data));
+        cv.notify_all();
+    }
+
+    // Only plain files can be patched after writing
+    bool seekable() const { return compr == Compr::none; }
+    // Replaces bytes already written at `pos`, e.g. a placeholder in the header
+    void overwrite(const long pos, const std::string& data) {
+        assert(seekable());
+        if (fseek(f, pos, SEEK_SET) != 0 || !raw_write(data.data(), data.size())
+            || fseek(f, 0, SEEK_END) != 0) fail(write_msg());
+    }
+
+private:
+    bool ends_with(const std::string& ext) const {
+        return fname.size() >= ext.size() &&
+            fname.compare(fname.size()-ext.size(), ext.size(), ext) == 0;
+    }
+    void open_error() const {
+        fail("Could not open file '" + fname + "' for writing: " + strerror(errno));
+    }
+    std::string write_msg() const {
+        return "Could not write to file '" + fname + "': " + strerror(errno);
+    }
+    // Only ever called on the caller's thread, never on the compressor's
+    [[noreturn]] void fail(const std::string& msg) const {
+        throw std::runtime_error(msg);
+    }
+    bool raw_write(const char* data, const size_t sz) {
+        return !sz || fwrite(data, 1, sz, f) == sz;
+    }
+
+    // Stops the compressor thread, ends the stream and closes the file.
+    // Returns the first error, or an empty string.
+    std::string finish() {
+        closed = true;
+        std::string e;
+        if (compr != Compr::none) {
+            {
+                std::lock_guard<std::mutex> lk(mu);
+                done = true;
+            }
+            cv.notify_all();
+            worker.join();
+            e = err;
+        }
+#ifdef USE_ZLIB
+        if (gz) {
+            const int r = gzclose(gz);
+            gz = nullptr;
+            if (r != Z_OK && e.empty()) e = "Could not close file '" + fname + "'";
+        }
+#endif
+#ifdef USE_ZSTD
+        if (zctx) {
+            ZSTD_inBuffer in = {nullptr, 0, 0};
+            size_t left;
+            do {
+                if (!e.empty()) break;
+                ZSTD_outBuffer o = {zout.data(), zout.size(), 0};
+                left = ZSTD_compressStream2(zctx, &o, &in, ZSTD_e_end);
+                if (ZSTD_isError(left)) e = zstd_msg(left);
+                else if (!raw_write(zout.data(), o.pos)) e = write_msg();
+            } while(left != 0);
+            ZSTD_freeCCtx(zctx);
+            zctx = nullptr;
+        }
+#endif
+        if (f) {
+            const int r = fclose(f);
+            f = nullptr;
+            if (r != 0 && e.empty()) e = "Could not close file '" + fname + "': " + strerror(errno);
+        }
+        return e;
+    }
+
+    void compress_loop() {
+        while(true) {
+            std::string data;
+            bool failed;
+            {
+                std::unique_lock<std::mutex> lk(mu);
+                cv.wait(lk, [&]() { return done || !queue.empty(); });
+                if (queue.empty()) return;
+                data = std::move(queue.front());
+                queue.pop_front();
+                failed = !err.empty();
+            }
+            cv.notify_all();
+            // After an error the rest is dropped, write() reports it
+            if (failed) continue;
+            std::string e = compress(data);
+            if (!e.empty()) {
+                std::lock_guard<std::mutex> lk(mu);
+                err = std::move(e);
+            }
+        }
+    }
+
+    // Returns the error, or an empty string
+    std::string compress(const std::string& data) {
+#ifdef USE_ZLIB
+        if (compr == Compr::gz) {
+            if (gzwrite(gz, data.data(), data.size()) != (int)data.size()) return write_msg();
+        }
+#endif
+#ifdef USE_ZSTD
+        if (compr == Compr::zstd) {
+            ZSTD_inBuffer in = {data.data(), data.size(), 0};
+            while(in.pos < in.size) {
+                ZSTD_outBuffer o = {zout.data(), zout.size(), 0};
+                const size_t r = ZSTD_compressStream2(zctx, &o, &in, ZSTD_e_continue);
+                if (ZSTD_isError(r)) return zstd_msg(r);
+                if (!raw_write(zout.data(), o.pos)) return write_msg();
+            }
+        }
+#else
+        (void)data;
+#endif
+        return std::string();
+    }
+
+#ifdef USE_ZSTD
+    std::string zstd_msg(const size_t r) const {
+        return "zstd compression of '" + fname + "' failed: " + ZSTD_getErrorName(r);
+    }
+    ZSTD_CCtx* zctx = nullptr;
+    std::vector<char> zout;
+#endif
+#ifdef USE_ZLIB
+    gzFile gz = nullptr;
+#endif
+
+    const std::string fname;
+    Compr compr = Compr::none;
+    FILE* f = nullptr;
+
+    static constexpr size_t max_queued = 4;
+    std::thread worker;
+    std::mutex mu;
+    std::condition_variable cv;
+    std::deque<std::string> queue;
+    bool done = false;
+    std::string err; // first error of the compressor thread, under `mu`
+    bool closed = false;
+};
@@ -0,0 +1,78 @@
+/*
+ Arjun
+
+ Copyright (c) 2019-2020, Mate Soos and Kuldeep S. Meel. All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "arjun.h"
+#include "time_mem.h"
+
+// Measures one phase from construction until finish() or destruction, and
+// appends it to `out`. Early returns are still recorded, only the counts
+// set so far are kept then.
+class PhaseTimer {
+public:
+    PhaseTimer(std::vector<ArjunNS::PhaseStats>& _out, const char* name) :
+        out(_out)
+    {
+        st.name = name;
+        st.peak_rss = rss();
+        wall_start = real_time_sec();
+        cpu_start = cpuTimeTotal();
+    }
+    ~PhaseTimer() { finish(); }
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+    void count(const char* what, const uint64_t val) {
+        for(auto& c: st.counts) if (c.first == what) { c.second = val; return; }
+        st.counts.emplace_back(what, val);
+    }
+
+    void finish() {
+        if (finished) return;
+        finished = true;
+        st.wall_time = real_time_sec() - wall_start;
+        st.cpu_time = cpuTimeTotal() - cpu_start;
+        st.peak_rss = std::max(st.peak_rss, rss());
+        out.push_back(std::move(st));
+    }
+
+private:
+    static uint64_t rss() {
+        double vm;
+        return memUsedTotal(vm);
+    }
+
+    std::vector<ArjunNS::PhaseStats>& out;
+    ArjunNS::PhaseStats st;
+    double wall_start;
+    double cpu_start;
+    bool finished = false;
+};
@@ -40,6 +40,7 @@
 #include "puura.h"
 #include "arjun.h"
 #include "common.h"
+#include "phase_stats.h"
 
 using namespace ArjunNS;
 using namespace CMSat;
@@ -48,7 +49,8 @@ using std::endl;
 using std::vector;
 
 
-Puura::Puura(const Config& _conf) : conf(_conf) {}
+Puura::Puura(const Config& _conf, vector<PhaseStats>& _phase_stats) :
+    conf(_conf), phase_stats(_phase_stats) {}
 Puura::~Puura() { delete solver; }
 
 SATSolver* Puura::setup_f_not_f_indic()
@@ -154,22 +156,14 @@ SATSolver* Puura::setup_f_not_f_indic()
     return s;
 }
 
-void Puura::get_simplified_cnf(SimplifiedCNF& scnf,
+// Everything but the clauses. Must be called after start_getting_constraints()
+void Puura::get_simplified_meta(SimplifiedCNF& scnf,
         const vector<uint32_t>& sampl_vars,
-        const vector<uint32_t>& set_sampl_vars,
         const vector<uint32_t>& empty_sampl_vars,
         const vector<uint32_t>& orig_sampl_vars) {
-    assert(scnf.cnf.empty());
-
-    vector<Lit> clause;
-    bool is_xor, rhs;
-
-
     scnf.sampl_vars = sampl_vars;
     scnf.weighted = solver->get_weighted();
 
-    solver->start_getting_constraints(false, true);
-
     // Weights/empties/etc
     const auto tmp = solver->translate_sampl_set(empty_sampl_vars);
     mpz_class dummy(2);
@@ -180,9 +174,26 @@ void Puura::get_simplified_cnf(SimplifiedCNF& scnf,
         solver->get_weights(scnf.weights, sampl_vars, orig_sampl_vars);
         // todo
     }
+#else
+    (void)orig_sampl_vars;
 #endif
 
     scnf.sampl_vars = solver->translate_sampl_set(scnf.sampl_vars);
+}
+
+void Puura::get_simplified_cnf(SimplifiedCNF& scnf,
+        const vector<uint32_t>& sampl_vars,
+        const vector<uint32_t>& set_sampl_vars,
+        const vector<uint32_t>& empty_sampl_vars,
+        const vector<uint32_t>& orig_sampl_vars) {
+    assert(scnf.cnf.empty());
+    PhaseTimer phase(phase_stats, "puura-extract");
+
+    vector<Lit> clause;
+    bool is_xor, rhs;
+
+    solver->start_getting_constraints(false, true);
+    get_simplified_meta(scnf, sampl_vars, empty_sampl_vars, orig_sampl_vars);
     while(solver->get_next_constraint(clause, is_xor, rhs)) {
         assert(!is_xor); assert(rhs);
         scnf.cnf.push_back(clause);
@@ -198,6 +209,63 @@ void Puura::get_simplified_cnf(SimplifiedCNF& scnf,
 
     scnf.nvars = solver->simplified_nvars();
     std::sort(scnf.sampl_vars.begin(), scnf.sampl_vars.end());
+    phase.count("clauses", scnf.cnf.size());
+    phase.count("red_clauses", scnf.red_cnf.size());
+}
+
+// The clauses are read out once, or twice when the sink needs their counts
+// up-front, e.g. for the header of a compressed DIMACS file
+void Puura::stream_simplified_cnf(SimplifiedCNFSink& sink,
+        const bool opt_sampl_is_all,
+        const bool red,
+        const vector<uint32_t>& sampl_vars,
+        const vector<uint32_t>& empty_sampl_vars,
+        const vector<uint32_t>& orig_sampl_vars) {
+    PhaseTimer phase(phase_stats, "stream-cnf");
+    vector<Lit> clause;
+    bool is_xor, rhs;
+
+    SimplifiedCNF meta;
+    uint64_t num[2] = {0, 0};
+    solver->start_getting_constraints(false, true);
+    get_simplified_meta(meta, sampl_vars, empty_sampl_vars, orig_sampl_vars);
+    solver->end_getting_constraints();
+    const bool counts_first = sink.counts_first();
+    if (counts_first) {
+        for(int r = 0; r < 1 + (int)red; r++) {
+            solver->start_getting_constraints(r, true);
+            while(solver->get_next_constraint(clause, is_xor, rhs)) num[r]++;
+            solver->end_getting_constraints();
+        }
+    }
+
+    meta.nvars = solver->simplified_nvars();
+    std::sort(meta.sampl_vars.begin(), meta.sampl_vars.end());
+    if (opt_sampl_is_all) {
+        for(uint32_t i = 0; i < meta.nvars; i++) meta.opt_sampl_vars.push_back(i);
+    } else {
+        meta.opt_sampl_vars = meta.sampl_vars;
+    }
+    const auto map_here_to_there = meta.ganak_var_map();
+    meta.renumber_meta(map_here_to_there);
+    sink.header(meta, num[0], num[1]);
+
+    for(int r = 0; r < 1 + (int)red; r++) {
+        uint64_t n = 0;
+        solver->start_getting_constraints(r, true);
+        while(solver->get_next_constraint(clause, is_xor, rhs)) {
+            assert(!is_xor); assert(rhs);
+            for(auto& l: clause) l = Lit(map_here_to_there[l.var()], l.sign());
+            sink.clause(clause, r);
+            n++;
+        }
+        solver->end_getting_constraints();
+        assert(!counts_first || n == num[r]);
+        num[r] = n;
+    }
+    sink.done(num[0], num[1]);
+    phase.count("clauses", num[0]);
+    phase.count("red_clauses", num[1]);
 }
 
 void Puura::fill_solver(Arjun* arjun) {
@@ -211,8 +279,15 @@ void Puura::fill_solver(Arjun* arjun) {
     // Inject original CNF
     const auto& cnf = arjun->get_orig_cnf();
     solver->new_vars(cnf.nvars);
-    for(const auto& cl: cnf.cnf) solver->add_clause(cl);
-    for(const auto& cl: cnf.red_cnf) solver->add_red_clause(cl);
+    vector<Lit> tmp;
+    for(const auto& cl: cnf.cnf) {
+        tmp.assign(cl.begin(), cl.end());
+        solver->add_clause(tmp);
+    }
+    for(const auto& cl: cnf.red_cnf) {
+        tmp.assign(cl.begin(), cl.end());
+        solver->add_red_clause(tmp);
+    }
 #ifdef WEIGHTED
     if (cnf.weighted) {
         for(const auto& it: cnf.weights) solver->set_lit_weight(it.first, it.second);
@@ -256,8 +331,35 @@ SimplifiedCNF Puura::get_fully_simplified_renumbered_cnf(
     vector<uint32_t>& set_sampl_vars,
     vector<uint32_t>& empty_sampl_vars,
     vector<uint32_t>& orig_sampl_vars)
+{
+    simplify_for_export(arjun, simp_conf, sampl_vars, empty_sampl_vars);
+    SimplifiedCNF cnf;
+    get_simplified_cnf(cnf, sampl_vars, set_sampl_vars, empty_sampl_vars, orig_sampl_vars);
+    return cnf;
+}
+
+void Puura::stream_fully_simplified_renumbered_cnf(
+    Arjun* arjun,
+    const SimpConf simp_conf,
+    SimplifiedCNFSink& sink,
+    const bool opt_sampl_is_all,
+    const bool red,
+    vector<uint32_t>& sampl_vars,
+    vector<uint32_t>& empty_sampl_vars,
+    vector<uint32_t>& orig_sampl_vars)
+{
+    simplify_for_export(arjun, simp_conf, sampl_vars, empty_sampl_vars);
+    stream_simplified_cnf(sink, opt_sampl_is_all, red, sampl_vars, empty_sampl_vars, orig_sampl_vars);
+}
+
+void Puura::simplify_for_export(
+    Arjun* arjun,
+    const SimpConf& simp_conf,
+    vector<uint32_t>& sampl_vars,
+    vector<uint32_t>& empty_sampl_vars)
 {
     verb_print(3, "Running "<< __PRETTY_FUNCTION__);
+    PhaseTimer iter1(phase_stats, "puura-iter1");
     fill_solver(arjun);
     solver->set_renumber(true);
     solver->set_scc(true);
@@ -286,8 +388,11 @@ SimplifiedCNF Puura::get_fully_simplified_renumbered_cnf(
     string str("must-scc-vrepl, full-probe, sub-cls-with-bin, sub-impl, distill-cls-onlyrem, occ-resolv-subs, occ-backw-sub, occ-rem-with-orgates, occ-bve, occ-ternary-res, intree-probe, occ-backw-sub-str, sub-str-cls-with-bin, clean-cls, distill-cls, distill-bins, ");
     if (simp_conf.appmc) str = string("must-scc-vrepl, full-probe, sub-cls-with-bin, sub-impl, distill-cls-onlyrem, occ-resolv-subs, occ-backw-sub, occ-bve, intree-probe, occ-backw-sub-str, sub-str-cls-with-bin, clean-cls, distill-cls, distill-bins, ");
     for (int i = 0; i < simp_conf.iter1; i++) solver->simplify(&dont_elim, &str);
+    iter1.count("vars", solver->nVars());
+    iter1.finish();
 
     // Now doing Oracle
+    PhaseTimer oracle(phase_stats, "puura-oracle");
     string str2;
     if (conf.bce) {str2 = "occ-bce"; solver->simplify(&dont_elim, &str2);}
     if (simp_conf.oracle_vivify && simp_conf.oracle_sparsify) str2 = "oracle-vivif-sparsify";
@@ -295,8 +400,10 @@ SimplifiedCNF Puura::get_fully_simplified_renumbered_cnf(
     else if (simp_conf.oracle_sparsify) str2 = "oracle-sparsify";
     else str2 = "";
     solver->simplify(&dont_elim, &str2);
+    oracle.finish();
 
     // Now more expensive BVE, also RED linked in to occur
+    PhaseTimer iter2(phase_stats, "puura-iter2");
     if (!simp_conf.appmc) {
         solver->set_min_bva_gain(simp_conf.bve_grow_iter2);
         solver->set_varelim_check_resolvent_subs(true);
@@ -311,14 +418,13 @@ SimplifiedCNF Puura::get_fully_simplified_renumbered_cnf(
     if (conf.bce) str += "occ-bce,";
     solver->simplify(&dont_elim, &str);
 
-    SimplifiedCNF cnf;
     solver->get_empties(sampl_vars, empty_sampl_vars);
     dont_elim.clear();
     for(uint32_t v: sampl_vars) dont_elim.push_back(Lit(v, false));
     str = "occ-bve-empty, must-renumber";
     solver->simplify(&dont_elim, &str);
-    get_simplified_cnf(cnf, sampl_vars, set_sampl_vars, empty_sampl_vars, orig_sampl_vars);
-    return cnf;
+    iter2.count("vars", solver->simplified_nvars());
+    iter2.count("empty", empty_sampl_vars.size());
 }
 
 void Puura::setup_sampl_vars_dontelim(const vector<uint32_t>& sampl_vars)
@@ -334,6 +440,8 @@ void Puura::run_sbva(SimplifiedCNF& orig,
 
     if (sbva_steps == 0) return;
 
+    PhaseTimer phase(phase_stats, "sbva");
+    phase.count("clauses_before", orig.cnf.size());
     auto my_time = cpuTime();
     verb_print(1, "[arjun-sbva] entering SBVA with"
             " vars: " << orig.nvars << " cls: " << orig.cnf.size());
@@ -351,25 +459,24 @@ void Puura::run_sbva(SimplifiedCNF& orig,
         for(const auto& l: cl) tmp.push_back((l.var()+1) * (l.sign() ? -1 : 1));
         cnf.add_cl(tmp);
     }
+    // SBVA has its own copy now, don't hold two
+    orig.cnf = FlatClauses();
     cnf.finish_cnf();
     assert(sbva_tiebreak == 0 || sbva_tiebreak == 1);
     cnf.run(sbva_tiebreak == 1 ? SBVA::Tiebreak::ThreeHop : SBVA::Tiebreak::None);
     uint32_t ncls;
     auto ret = cnf.get_cnf(orig.nvars, ncls);
 
-    orig.cnf.clear();
-    vector<Lit> cl;
-    uint32_t at = 0;
-    while(ret.size() > at) {
-        int l = ret[at++];
-        if (l == 0) {
-            orig.cnf.push_back(cl);
-            cl.clear();
-            continue;
-        }
-        cl.push_back(Lit(std::abs(l)-1, l < 0));
+    // Decoded straight into the flat storage, sized exactly up-front
+    orig.cnf.reserve(ncls, ret.size()-ncls);
+    for(const int l: ret) {
+        if (l == 0) orig.cnf.finish_clause();
+        else orig.cnf.push_lit(Lit(std::abs(l)-1, l < 0));
     }
-    assert(cl.empty() && "SBVA should have ended with a 0");
+    assert(orig.cnf.unfinished_lits() == 0 && "SBVA should have ended with a 0");
+    ret = vector<int>();
+    phase.count("clauses_after", orig.cnf.size());
+    phase.count("vars_after", orig.nvars);
 
     if (conf.verb) {
         cout << "c [arjun-sbva] steps remainK: " << std::setprecision(2) << std::fixed
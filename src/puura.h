@@ -40,7 +40,7 @@ using std::set;
 
 class Puura {
 public:
-    Puura(const Config& _conf);
+    Puura(const Config& _conf, vector<PhaseStats>& _phase_stats);
     ~Puura();
 
     SimplifiedCNF get_fully_simplified_renumbered_cnf(
@@ -51,6 +51,16 @@ public:
         vector<uint32_t>& empty_sampl_vars,
         vector<uint32_t>& orig_sampl_vars);
 
+    void stream_fully_simplified_renumbered_cnf(
+        Arjun* arjun,
+        const SimpConf simp_conf,
+        SimplifiedCNFSink& sink,
+        const bool opt_sampl_is_all,
+        const bool red,
+        vector<uint32_t>& sampl_vars,
+        vector<uint32_t>& empty_sampl_vars,
+        vector<uint32_t>& orig_sampl_vars);
+
     void run_sbva(SimplifiedCNF& orig,
         int64_t sbva_steps, uint32_t sbva_cls_cutoff, uint32_t sbva_lits_cutoff, int sbva_tiebreak);
 
@@ -61,6 +71,21 @@ private:
 
     void fill_solver(Arjun* arjun);
     void renumber_sampling_vars_for_ganak(SimplifiedCNF& scnf);
+    void simplify_for_export(
+        Arjun* arjun,
+        const SimpConf& simp_conf,
+        vector<uint32_t>& sampl_vars,
+        vector<uint32_t>& empty_sampl_vars);
+    void get_simplified_meta(SimplifiedCNF& scnf,
+        const vector<uint32_t>& sampl_vars,
+        const vector<uint32_t>& empty_sampl_vars,
+        const vector<uint32_t>& orig_sampl_vars);
+    void stream_simplified_cnf(SimplifiedCNFSink& sink,
+        const bool opt_sampl_is_all,
+        const bool red,
+        const vector<uint32_t>& sampl_vars,
+        const vector<uint32_t>& empty_sampl_vars,
+        const vector<uint32_t>& orig_sampl_vars);
     void get_simplified_cnf(SimplifiedCNF& sncf,
         const vector<uint32_t>& sampl_vars,
         const vector<uint32_t>& set_sampl_vars,
@@ -68,6 +93,7 @@ private:
         const vector<uint32_t>& orig_sampl_vars);
 
     const Config& conf;
+    vector<PhaseStats>& phase_stats;
 
     // For the unit/flippable
     //
@@ -0,0 +1,423 @@
+/*
+ Arjun
+
+ Copyright (c) 2019-2020, Mate Soos and Kuldeep S. Meel. All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ */
+
+#pragma once
+
+// Binary SimplifiedCNF format. All integers are LEB128 varints:
+//   magic "ARJBCNF\n", version
+//   weighted, nvars, #clauses, #red clauses (the counts padded to 10 bytes,
+//   so a streamed file can fill them in at the end)
+//   sampl_vars, opt_sampl_vars: count, then sorted vars as deltas
+//   multiplier weight: length, then decimal digits
+//   clauses, then red clauses: length, then Lit::toInt() of each literal
+//   weights: count, then Lit::toInt() and the 8 bytes of the double
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <gmpxx.h>
+#include <cryptominisat5/solvertypesmini.h>
+
+#include "arjun.h"
+
+constexpr char simpcnf_bin_magic[8] = {'A','R','J','B','C','N','F','\n'};
+constexpr uint32_t simpcnf_bin_version = 1;
+
+inline bool is_simpcnf_bin_fname(const std::string& fname)
+{
+    const std::string ext = ".bcnf";
+    return fname.size() >= ext.size() &&
+        fname.compare(fname.size()-ext.size(), ext.size(), ext) == 0;
+}
+
+// Throws std::runtime_error if the file cannot be written
+class BinCNFWriter
+{
+public:
+    BinCNFWriter(const std::string& _fname) : fname(_fname) {
+        f = fopen(fname.c_str(), "wb");
+        if (!f) {
+            throw std::runtime_error("Could not open file '" + fname + "' for writing: "
+                + strerror(errno));
+        }
+    }
+    // Errors cannot be reported from here, call close() for that
+    ~BinCNFWriter() {
+        if (!f) return;
+        if (!buf.empty()) fwrite(buf.data(), 1, buf.size(), f);
+        fclose(f);
+    }
+    // Writes out the buffer and closes the file, checking both
+    void close() {
+        flush();
+        const int r = fclose(f);
+        f = nullptr;
+        if (r != 0) write_error();
+    }
+    void raw(const void* data, size_t sz) {
+        const char* d = (const char*)data;
+        buf.insert(buf.end(), d, d+sz);
+        if (buf.size() > (1U << 20)) flush();
+    }
+    void varint(uint64_t v) {
+        while(v >= 0x80) {
+            buf.push_back((char)(v | 0x80));
+            v >>= 7;
+        }
+        buf.push_back((char)v);
+        if (buf.size() > (1U << 20)) flush();
+    }
+    // Same value as varint(), always taking the 10 bytes of the largest one
+    static std::string fixed_varint(uint64_t v) {
+        std::string s;
+        for(uint32_t i = 0; i < 9; i++) {
+            s.push_back((char)((v & 0x7f) | 0x80));
+            v >>= 7;
+        }
+        s.push_back((char)v);
+        return s;
+    }
+    // Bytes written so far
+    uint64_t pos() const { return flushed + buf.size(); }
+    // Replaces bytes already written at `pos`, e.g. a placeholder in the header
+    void overwrite(const long at, const std::string& data) {
+        flush();
+        if (fseek(f, at, SEEK_SET) != 0 || fwrite(data.data(), 1, data.size(), f) != data.size()
+                || fseek(f, 0, SEEK_END) != 0) write_error();
+    }
+    void vars(std::vector<uint32_t> vs) {
+        std::sort(vs.begin(), vs.end());
+        varint(vs.size());
+        uint32_t last = 0;
+        for(const auto& v: vs) {
+            varint(v - last);
+            last = v;
+        }
+    }
+    void cls(const ArjunNS::FlatClauses& cs) {
+        for(const auto& cl: cs) {
+            varint(cl.size());
+            for(const auto& l: cl) varint(l.toInt());
+        }
+    }
+
+private:
+    void flush() {
+        if (!buf.empty() && fwrite(buf.data(), 1, buf.size(), f) != buf.size()) write_error();
+        flushed += buf.size();
+        buf.clear();
+    }
+    [[noreturn]] void write_error() const {
+        throw std::runtime_error("Could not write to file '" + fname + "': " + strerror(errno));
+    }
+    const std::string fname;
+    FILE* f;
+    std::vector<char> buf;
+    uint64_t flushed = 0;
+};
+
+inline std::string simpcnf_bin_counts(const uint64_t num_cls, const uint64_t num_red)
+{
+    return BinCNFWriter::fixed_varint(num_cls) + BinCNFWriter::fixed_varint(num_red);
+}
+
+// Returns where the clause counts are in the file
+inline uint64_t write_simpcnf_bin_header(BinCNFWriter& w,
+        const ArjunNS::SimplifiedCNF& simpcnf, const uint64_t num_cls, const uint64_t num_red)
+{
+    w.raw(simpcnf_bin_magic, sizeof(simpcnf_bin_magic));
+    w.varint(simpcnf_bin_version);
+    w.varint(simpcnf.weighted);
+    w.varint(simpcnf.nvars);
+    const uint64_t counts_at = w.pos();
+    const std::string counts = simpcnf_bin_counts(num_cls, num_red);
+    w.raw(counts.data(), counts.size());
+    w.vars(simpcnf.sampl_vars);
+    w.vars(simpcnf.opt_sampl_vars);
+    const std::string mult = simpcnf.multiplier_weight.get_str();
+    w.varint(mult.size());
+    w.raw(mult.data(), mult.size());
+    return counts_at;
+}
+
+inline void write_simpcnf_bin_weights(BinCNFWriter& w, const ArjunNS::SimplifiedCNF& simpcnf)
+{
+#ifdef WEIGHTED
+    if (simpcnf.weighted) {
+        w.varint(simpcnf.weights.size());
+        for(const auto& it: simpcnf.weights) {
+            w.varint(it.first.toInt());
+            uint64_t bits;
+            memcpy(&bits, &it.second, sizeof(bits));
+            for(uint32_t i = 0; i < 8; i++) {
+                const char c = bits >> (8*i);
+                w.raw(&c, 1);
+            }
+        }
+    } else w.varint(0);
+#else
+    (void)simpcnf;
+    w.varint(0);
+#endif
+}
+
+inline void write_simpcnf_bin(const ArjunNS::SimplifiedCNF& simpcnf,
+        const std::string& fname, bool red = true)
+{
+    BinCNFWriter w(fname);
+    write_simpcnf_bin_header(w, simpcnf, simpcnf.cnf.size(), red ? simpcnf.red_cnf.size() : 0);
+    w.cls(simpcnf.cnf);
+    if (red) w.cls(simpcnf.red_cnf);
+    write_simpcnf_bin_weights(w, simpcnf);
+    w.close();
+}
+
+// Writes the same file as write_simpcnf_bin(), for
+// Arjun::stream_fully_simplified_renumbered_cnf(). The clause counts are
+// filled in at the end.
+class BinCNFFileSink : public ArjunNS::SimplifiedCNFSink {
+public:
+    BinCNFFileSink(const std::string& fname) : w(fname) {}
+    bool counts_first() const override { return false; }
+    void header(const ArjunNS::SimplifiedCNF& _meta, uint64_t num_cls, uint64_t num_red) override {
+        meta = _meta;
+        counts_at = write_simpcnf_bin_header(w, meta, num_cls, num_red);
+    }
+    void clause(const std::vector<CMSat::Lit>& cl, bool) override {
+        w.varint(cl.size());
+        for(const auto& l: cl) w.varint(l.toInt());
+    }
+    void done(uint64_t num_cls, uint64_t num_red) override {
+        write_simpcnf_bin_weights(w, meta);
+        w.overwrite(counts_at, simpcnf_bin_counts(num_cls, num_red));
+        w.close();
+    }
+
+private:
+    BinCNFWriter w;
+    ArjunNS::SimplifiedCNF meta;
+    uint64_t counts_at = 0;
+};
+
+// Throws std::runtime_error if the file cannot be read or is corrupt
+class BinCNFReader
+{
+public:
+    BinCNFReader(const std::string& _fname) : fname(_fname) {
+        f = fopen(fname.c_str(), "rb");
+        if (!f) {
+            throw std::runtime_error("Could not open file '" + fname + "' for reading: "
+                + strerror(errno));
+        }
+        // To check lengths against, so a corrupt one can't make us allocate
+        // a lot. Unknown, e.g. for a pipe, if not seekable.
+        if (fseek(f, 0, SEEK_END) == 0) {
+            const long sz = ftell(f);
+            if (sz >= 0) size = sz;
+            rewind(f);
+        }
+        buf.resize(1U << 20);
+    }
+    ~BinCNFReader() { fclose(f); }
+    void raw(void* data, size_t sz) {
+        char* d = (char*)data;
+        for(size_t i = 0; i < sz; i++) d[i] = get();
+    }
+    uint64_t varint() {
+        uint64_t v = 0;
+        for(uint32_t shift = 0; shift < 64; shift += 7) {
+            const unsigned char c = get();
+            v |= (uint64_t)(c & 0x7f) << shift;
+            if (!(c & 0x80)) return v;
+        }
+        corrupt("varint too long");
+        return 0;
+    }
+    // Number of elements to follow, each taking at least one byte
+    uint64_t length() {
+        const uint64_t n = varint();
+        if (n > size - (read + at - len)) corrupt("length " + std::to_string(n) + " is past the end of the file");
+        return n;
+    }
+    CMSat::Lit lit(const uint32_t nvars) {
+        const uint64_t l = varint();
+        if (l/2 >= nvars) corrupt("literal out of range");
+        return CMSat::Lit(l/2, l&1);
+    }
+    void vars(std::vector<uint32_t>& vs, const uint32_t nvars) {
+        vs.resize(length());
+        uint64_t last = 0;
+        for(auto& v: vs) {
+            last += varint();
+            if (last >= nvars) corrupt("variable out of range");
+            v = last;
+        }
+    }
+    [[noreturn]] void corrupt(const std::string& why) {
+        throw std::runtime_error("Binary CNF file '" + fname + "' is corrupt: " + why);
+    }
+
+private:
+    char get() {
+        if (at == len) {
+            len = fread(buf.data(), 1, buf.size(), f);
+            read += len;
+            at = 0;
+            if (len == 0) corrupt("unexpected end of file");
+        }
+        return buf[at++];
+    }
+    std::string fname;
+    FILE* f;
+    std::vector<char> buf;
+    size_t at = 0;
+    size_t len = 0;
+    uint64_t read = 0;
+    uint64_t size = std::numeric_limits<uint64_t>::max();
+};
+
+inline bool is_simpcnf_bin_file(const std::string& fname)
+{
+    char magic[sizeof(simpcnf_bin_magic)];
+    FILE* f = fopen(fname.c_str(), "rb");
+    if (!f) return false;
+    const bool ok = fread(magic, 1, sizeof(magic), f) == sizeof(magic) &&
+        memcmp(magic, simpcnf_bin_magic, sizeof(magic)) == 0;
+    fclose(f);
+    return ok;
+}
+
+// Decodes the file and hands its contents out in the order stored
+struct BinCNFSink {
+    std::function<void(bool weighted, uint32_t nvars)> header;
+    std::function<void(const std::vector<uint32_t>& sampl, const std::vector<uint32_t>& opt_sampl)> sampl_vars;
+    std::function<void(const mpz_class& mult)> multiplier;
+    std::function<void(const std::vector<CMSat::Lit>& cl, bool red)> clause;
+    std::function<void(CMSat::Lit l, double w)> weight;
+};
+
+inline void read_simpcnf_bin(const std::string& fname, const BinCNFSink& sink)
+{
+    BinCNFReader r(fname);
+    char magic[sizeof(simpcnf_bin_magic)];
+    r.raw(magic, sizeof(magic));
+    if (memcmp(magic, simpcnf_bin_magic, sizeof(magic)) != 0) r.corrupt("wrong magic");
+    const uint64_t version = r.varint();
+    if (version != simpcnf_bin_version) {
+        r.corrupt("version " + std::to_string(version) + " is not supported, only version "
+            + std::to_string(simpcnf_bin_version));
+    }
+    const bool weighted = r.varint();
+    const uint64_t nvars = r.varint();
+    if (nvars > std::numeric_limits<int32_t>::max()) r.corrupt("too many variables");
+    const uint64_t num_cls = r.varint();
+    const uint64_t num_red = r.varint();
+    sink.header(weighted, nvars);
+
+    std::vector<uint32_t> sampl, opt_sampl;
+    r.vars(sampl, nvars);
+    r.vars(opt_sampl, nvars);
+    sink.sampl_vars(sampl, opt_sampl);
+
+    std::string mult(r.length(), '0');
+    r.raw(&mult[0], mult.size());
+    mpz_class m;
+    if (m.set_str(mult, 10) != 0) r.corrupt("bad multiplier weight");
+    sink.multiplier(m);
+
+    std::vector<CMSat::Lit> cl;
+    for(uint64_t i = 0; i < num_cls + num_red; i++) {
+        cl.resize(r.length());
+        for(auto& l: cl) l = r.lit(nvars);
+        sink.clause(cl, i >= num_cls);
+    }
+
+    const uint64_t num_weights = r.varint();
+    for(uint64_t i = 0; i < num_weights; i++) {
+        const CMSat::Lit l = r.lit(nvars);
+        uint64_t bits = 0;
+        for(uint32_t j = 0; j < 8; j++) {
+            unsigned char c;
+            r.raw(&c, 1);
+            bits |= (uint64_t)c << (8*j);
+        }
+        double w;
+        memcpy(&w, &bits, sizeof(w));
+        sink.weight(l, w);
+    }
+}
+
+inline void read_simpcnf_bin(const std::string& fname, ArjunNS::SimplifiedCNF& cnf)
+{
+    BinCNFSink sink;
+    sink.header = [&](bool weighted, uint32_t nvars) {
+        cnf = ArjunNS::SimplifiedCNF();
+        cnf.weighted = weighted;
+        cnf.nvars = nvars;
+    };
+    sink.sampl_vars = [&](const std::vector<uint32_t>& s, const std::vector<uint32_t>& o) {
+        cnf.sampl_vars = s;
+        cnf.opt_sampl_vars = o;
+    };
+    sink.multiplier = [&](const mpz_class& m) { cnf.multiplier_weight = m; };
+    sink.clause = [&](const std::vector<CMSat::Lit>& cl, bool red) {
+        if (red) cnf.red_cnf.push_back(cl);
+        else cnf.cnf.push_back(cl);
+    };
+    sink.weight = [&]([[maybe_unused]] CMSat::Lit l, [[maybe_unused]] double w) {
+#ifdef WEIGHTED
+        cnf.weights[l] = w;
+#endif
+    };
+    read_simpcnf_bin(fname, sink);
+}
+
+// Like the DIMACS parser, the optional sampling set is not ingested
+inline void read_simpcnf_bin(const std::string& fname, ArjunNS::Arjun* arjun)
+{
+    BinCNFSink sink;
+    sink.header = [&](bool, uint32_t nvars) {
+        if (arjun->nVars() < nvars) arjun->new_vars(nvars - arjun->nVars());
+    };
+    sink.sampl_vars = [&](const std::vector<uint32_t>& s, const std::vector<uint32_t>&) {
+        arjun->set_sampl_vars(s);
+    };
+    sink.multiplier = [&](const mpz_class& m) { arjun->set_multiplier_weight(m); };
+    sink.clause = [&](const std::vector<CMSat::Lit>& cl, bool red) {
+        if (red) arjun->add_red_clause(cl);
+        else arjun->add_clause(cl);
+    };
+    sink.weight = [&](CMSat::Lit l, double w) {
+        if (arjun->get_weighted()) arjun->set_lit_weight(l, w);
+    };
+    read_simpcnf_bin(fname, sink);
+}
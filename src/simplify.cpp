@@ -23,6 +23,12 @@
  */
 
 #include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <thread>
 #include "common.h"
 
 using std::pair;
@@ -45,6 +51,10 @@ bool Common::simplify() {
     check_no_duplicate_in_sampling_set();
     auto old_size = sampling_set.size();
     double my_time = cpuTime();
+    // Before the config below is changed, it's part of the key
+    const string cache_fname = gate_cache_fname();
+    vector<GateDef> cached_defs;
+    const bool cache_hit = !cache_fname.empty() && load_gate_cache(cache_fname, cached_defs);
 
     if (conf.probe_based && !probe_all()) return false;
     remove_zero_assigned_literals();
@@ -73,9 +83,12 @@ bool Common::simplify() {
     }
 
     if (!orig_cnf.weighted) {
-        if (conf.xor_gates_based || conf.or_gate_based || conf.ite_gate_based)
-            remove_definable_by_gates();
-        if (conf.irreg_gate_based) remove_definable_by_irreg_gates();
+        if (cache_hit) apply_gate_defs(cached_defs);
+        else {
+            if (conf.xor_gates_based || conf.or_gate_based || conf.ite_gate_based)
+                remove_definable_by_gates();
+            if (conf.irreg_gate_based) remove_definable_by_irreg_gates();
+        }
     }
 
     // Find at least one solution (so it's not UNSAT) within some timeout
@@ -89,9 +102,10 @@ bool Common::simplify() {
     remove_zero_assigned_literals();
     remove_eq_literals();
     get_empty_occs();
-    if (!orig_cnf.weighted) {
+    if (!orig_cnf.weighted && !cache_hit) {
         if (conf.irreg_gate_based) remove_definable_by_irreg_gates();
     }
+    if (!cache_fname.empty() && !cache_hit) save_gate_cache(cache_fname);
 
     solver->set_verbosity(std::max<int>(conf.verb-2, 0));
 
@@ -113,19 +127,93 @@ void Common::empty_out_indep_set_if_unsat() {
     verb_print(1, "[arjun] CNF is UNSAT, setting sampling set to empty");
 }
 
+struct ProbeResult {
+    vector<uint32_t> min_props; // for the worker's slice of the sampling set
+    vector<Lit> units;
+    vector<std::pair<Lit, Lit>> eqs;
+    bool unsat = false;
+};
+
+// Every worker probes a fixed slice of the sampling set on its own copy of
+// the current clauses. Whatever they find is implied by the formula, so it is
+// merged back in worker order, which keeps the result independent of timing.
+bool Common::probe_all_par()
+{
+    double my_time = real_time_sec();
+    const auto cnf = get_init_cnf();
+    const uint32_t num = conf.num_threads;
+    const uint32_t per = (sampling_set.size() + num - 1)/num;
+    vector<ProbeResult> res(num);
+
+    auto worker = [&](const uint32_t at) {
+        ProbeResult& r = res[at];
+        const uint32_t from = std::min<size_t>(at*per, sampling_set.size());
+        const uint32_t to = std::min<size_t>(from+per, sampling_set.size());
+        SATSolver* s = new_solver_copy(cnf);
+        for(uint32_t i = from; i < to; i++) {
+            uint32_t min_props = 0;
+            if (s->probe(Lit(sampling_set[i], false), min_props) == l_False) {
+                r.unsat = true;
+                break;
+            }
+            r.min_props.push_back(min_props);
+        }
+        if (!r.unsat) {
+            r.units = s->get_zero_assigned_lits();
+            r.eqs = s->get_all_binary_xors();
+        }
+        delete s;
+    };
+    vector<std::thread> threads;
+    for(uint32_t i = 0; i < num; i++) threads.push_back(std::thread(worker, i));
+    for(auto& t: threads) t.join();
+
+    uint32_t num_units = 0;
+    uint32_t num_eqs = 0;
+    for(uint32_t at = 0; at < num; at++) {
+        const ProbeResult& r = res[at];
+        if (r.unsat) {
+            solver->add_clause(vector<Lit>());
+            return false;
+        }
+        for(uint32_t i = 0; i < r.min_props.size(); i++)
+            incidence_probing[sampling_set[at*per+i]] = r.min_props[i];
+        for(const auto& l: r.units) {
+            if (!solver->add_clause(vector<Lit>{l})) return false;
+            num_units++;
+        }
+        for(const auto& p: r.eqs) {
+            if (!solver->add_clause(vector<Lit>{~p.first, p.second})) return false;
+            if (!solver->add_clause(vector<Lit>{p.first, ~p.second})) return false;
+            num_eqs++;
+        }
+    }
+    verb_print(1, "[arjun-simp] parallel probe"
+        << " threads: " << num
+        << " units: " << num_units
+        << " eqs: " << num_eqs
+        << " T: " << std::setprecision(2) << std::fixed << (real_time_sec() - my_time));
+    return true;
+}
+
 bool Common::probe_all()
 {
+    PhaseTimer phase(phase_stats, "probe");
     double my_time = cpuTime();
     order_sampl_set_for_simp();
     auto old_size = sampling_set.size();
 
     verb_print(1, "[arjun-simp] probing all sampling variables");
     incidence_probing.resize(orig_num_vars, 0);
-    for(auto v: sampling_set) {
-        uint32_t min_props = 0;
-        Lit l(v, false);
-        if(solver->probe(l, min_props) == l_False) return false;
-        incidence_probing[v] = min_props;
+    if (conf.num_threads > 1 && sampling_set.size() >= 1000) {
+        if (!probe_all_par()) return false;
+    } else {
+        for(auto v: sampling_set) {
+            uint32_t min_props = 0;
+            Lit l(v, false);
+            if(solver->probe(l, min_props) == l_False) return false;
+            incidence_probing[v] = min_props;
+        }
     }
     string s("must-scc-vrepl");
     if (solver->simplify(nullptr, &s) == l_False) return false;
@@ -133,6 +221,8 @@ bool Common::probe_all()
     remove_zero_assigned_literals(true);
     remove_eq_literals(true);
 
+    phase.count("vars", old_size);
+    phase.count("removed", old_size-sampling_set.size());
     verb_print(1, "[arjun-simp] probe"
         << " removed: " << (old_size-sampling_set.size())
         << " perc: " << std::fixed << std::setprecision(2)
@@ -146,6 +236,7 @@ enum class GateT {or_gate, xor_gate, ite_gate};
 
 struct GateOccurs
 {
+    GateOccurs() = default;
     GateOccurs(GateT _t, uint32_t _at) :
         t(_t),
         at(_at)
@@ -155,11 +246,121 @@ struct GateOccurs
     uint32_t at;
 };
 
+// The gates that could define each var, in CSR form: those of var v are
+// occs[start[v]] ... occs[start[v+1]-1], XORs first, then ORs, then ITEs,
+// each in the order the solver returned them.
+struct GateOccIndex
+{
+    vector<uint32_t> start;
+    vector<GateOccurs> occs;
+    uint32_t potential = 0;
+
+    bool empty(const uint32_t v) const { return start[v] == start[v+1]; }
+};
+
+// A gate can only define a var if all its vars are original vars that are
+// in the sampling set (marked in `seen`). Reads `seen` only, and the gates
+// are split into ranges that are counted and then filled on separate
+// threads, through one array of atomic counters. Threads fill a var's slots
+// in any order, so each var's gates are sorted back into gate order after,
+// and the index is the same for any number of threads.
+static void build_gate_occs(
+    GateOccIndex& idx,
+    const vector<char>& seen,
+    const uint32_t orig_num_vars,
+    const vector<pair<vector<uint32_t>, bool>>& xors,
+    const vector<OrGate>& ors,
+    const vector<ITEGate>& ites,
+    const uint32_t num_threads)
+{
+    const size_t num_gates = xors.size() + ors.size() + ites.size();
+    auto in_set = [&](const uint32_t v) { return v < orig_num_vars && seen[v]; };
+    // Calls f(var, occurrence) for every var gate `g` can define
+    auto for_each_def = [&](const size_t g, auto&& f) {
+        if (g < xors.size()) {
+            const auto& x = xors[g];
+            for(const uint32_t v: x.first) if (!in_set(v)) return;
+            for(const uint32_t v: x.first) f(v, GateOccurs(GateT::xor_gate, g));
+        } else if (g < xors.size() + ors.size()) {
+            const uint32_t at = g - xors.size();
+            const auto& o = ors[at];
+            for(const Lit& l: o.lits) if (!in_set(l.var())) return;
+            if (!in_set(o.rhs.var())) return;
+            f(o.rhs.var(), GateOccurs(GateT::or_gate, at));
+        } else {
+            const uint32_t at = g - xors.size() - ors.size();
+            const auto& ite = ites[at];
+            for(const Lit& l: ite.get_all()) if (!in_set(l.var())) return;
+            f(ite.rhs.var(), GateOccurs(GateT::ite_gate, at));
+        }
+    };
+
+    // Not worth the threads for a few gates
+    constexpr size_t min_per_thread = 50000;
+    const size_t nthr = std::max<size_t>(1,
+        std::min<size_t>(num_threads, num_gates/min_per_thread));
+    const size_t chunk = (num_gates + nthr - 1)/nthr;
+    auto run = [&](auto&& work) {
+        vector<std::thread> ts;
+        for(size_t t = 1; t < nthr; t++) ts.emplace_back(work, t);
+        work(0);
+        for(auto& th: ts) th.join();
+    };
+
+    // cnt[v] is the number of slots v needs, and then the position the next
+    // one of v is written to
+    vector<std::atomic<uint32_t>> cnt(orig_num_vars);
+    run([&](const size_t t) {
+        const size_t end = std::min(num_gates, (t+1)*chunk);
+        for(size_t g = t*chunk; g < end; g++)
+            for_each_def(g, [&](const uint32_t v, const GateOccurs&) {
+                cnt[v].fetch_add(1, std::memory_order_relaxed); });
+    });
+
+    idx.start.resize(orig_num_vars+1);
+    uint32_t pos = 0;
+    for(uint32_t v = 0; v < orig_num_vars; v++) {
+        idx.start[v] = pos;
+        pos += cnt[v].load(std::memory_order_relaxed);
+        cnt[v].store(idx.start[v], std::memory_order_relaxed);
+    }
+    idx.start[orig_num_vars] = pos;
+    idx.potential = pos;
+    idx.occs.resize(pos);
+
+    run([&](const size_t t) {
+        const size_t end = std::min(num_gates, (t+1)*chunk);
+        for(size_t g = t*chunk; g < end; g++)
+            for_each_def(g, [&](const uint32_t v, const GateOccurs& occ) {
+                idx.occs[cnt[v].fetch_add(1, std::memory_order_relaxed)] = occ; });
+    });
+    if (nthr == 1) return;
+
+    // Position of the gate in the XOR, OR, ITE order of for_each_def()
+    auto gate_num = [&](const GateOccurs& o) -> size_t {
+        switch(o.t) {
+            case GateT::xor_gate: return o.at;
+            case GateT::or_gate: return xors.size() + o.at;
+            case GateT::ite_gate: return xors.size() + ors.size() + o.at;
+        }
+        assert(false);
+        return 0;
+    };
+    const uint32_t vchunk = (orig_num_vars + nthr - 1)/nthr;
+    run([&](const size_t t) {
+        const uint32_t end = std::min<size_t>(orig_num_vars, (t+1)*vchunk);
+        for(uint32_t v = t*vchunk; v < end; v++) {
+            std::sort(idx.occs.begin() + idx.start[v], idx.occs.begin() + idx.start[v+1],
+                [&](const GateOccurs& a, const GateOccurs& b) { return gate_num(a) < gate_num(b); });
+        }
+    });
+}
+
 bool Common::remove_definable_by_gates() {
+    PhaseTimer phase(phase_stats, "gates");
     double my_time = cpuTime();
     order_sampl_set_for_simp();
     uint32_t old_size = sampling_set.size();
-    vector<vector<GateOccurs>> vars_gate_occurs(orig_num_vars);
     vector<pair<vector<uint32_t>, bool>> xors;
     vector<OrGate> ors;
     vector<ITEGate> ites;
@@ -175,78 +376,9 @@ bool Common::remove_definable_by_gates() {
         seen[v] = 1;
     }
 
-    vector<uint32_t> rhs_incidence(solver->nVars(), 0);
-
-    //Build occur for XOR
-    uint32_t potential = 0;
-    for(uint32_t i = 0; i < xors.size(); i ++) {
-        const auto& x = xors[i];
-        uint32_t num = 0;
-        bool all_orig = true;
-        for(auto v: x.first) {
-            if (v < orig_num_vars) {
-                num += seen[v];
-            } else {
-                all_orig = false;
-                break;
-            }
-        }
-        //This one can be used to remove a variable
-        if (all_orig && num == x.first.size()) {
-            for(const uint32_t v: x.first) {
-                rhs_incidence[v]++;
-                vars_gate_occurs[v].push_back(GateOccurs(GateT::xor_gate, i));
-                potential++;
-            }
-        }
-    }
-
-    //Build occur for OR
-    for(uint32_t i = 0; i < ors.size(); i ++) {
-        const auto& orgate = ors[i];
-        uint32_t num = 0;
-        bool all_orig = true;
-        for(const Lit& l: orgate.lits) {
-            if (l.var() < orig_num_vars) num += seen[l.var()];
-            else {
-                all_orig = false;
-                break;
-            }
-        }
-        if (orgate.rhs.var() < orig_num_vars) num += seen[orgate.rhs.var()];
-        else {
-            all_orig = false;
-            break;
-        }
-        //This one can be used to remove a variable
-        if (all_orig && num == orgate.lits.size()+1) {
-            rhs_incidence[orgate.rhs.var()]++;
-            vars_gate_occurs[orgate.rhs.var()].push_back(GateOccurs(GateT::or_gate, i));
-            potential++;
-        }
-    }
-
-    //Build occur for ITE
-    for(uint32_t i = 0; i < ites.size(); i ++) {
-        const auto& itegate = ites[i];
-        uint32_t num = 0;
-        bool all_orig = true;
-        for(const Lit& l: itegate.get_all()) {
-            if (l.var() < orig_num_vars) {
-                num += seen[l.var()];
-            } else {
-                all_orig = false;
-                break;
-            }
-        }
-        //This one can be used to remove a variable
-        if (all_orig && num == itegate.get_all().size()) {
-            rhs_incidence[itegate.rhs.var()]++;
-            vars_gate_occurs[itegate.rhs.var()].push_back(GateOccurs(GateT::ite_gate, i));
-            potential++;
-        }
-    }
-
+    GateOccIndex vars_gate_occurs;
+    build_gate_occs(vars_gate_occurs, seen, orig_num_vars, xors, ors, ites, conf.num_threads);
+    const uint32_t potential = vars_gate_occurs.potential;
     verb_print(4, "[arjun-simp] XOR Potential: " << potential);
 
     order_sampl_set_for_simp();
@@ -262,7 +394,7 @@ bool Common::remove_definable_by_gates() {
 
     for(uint32_t v: sampling_set) {
         assert(seen[v]);
-        if (vars_gate_occurs[v].empty()) continue;
+        if (vars_gate_occurs.empty(v)) continue;
 
         // Only try removing if it's at the bottom X percent of unknown_sort
         // If 0.01 is SMALLER, then we have to remove with backward LESS
@@ -272,7 +404,8 @@ bool Common::remove_definable_by_gates() {
         //cout << "Trying to define var " << v << " size of lookup: " << vars_xor_occurs[v].size() << endl;
 
         //Define v as a function of the other variables in the XOR
-        for(const auto& gate: vars_gate_occurs[v]) {
+        for(uint32_t k = vars_gate_occurs.start[v]; k < vars_gate_occurs.start[v+1]; k++) {
+            const auto& gate = vars_gate_occurs.occs[k];
             if (gate.t == GateT::xor_gate) {
                 const auto& x = xors[gate.at];
                 bool ok = true;
@@ -296,6 +429,8 @@ bool Common::remove_definable_by_gates() {
                 //All good, we can define v in terms of the other variables
                 assert(found_v);
                 seen[v] = 0;
+                gate_defs.push_back({GateDefT::xor_gate, {v}, {}});
+                for(auto xor_v: x.first) if (xor_v != v) gate_defs.back().inputs.push_back(xor_v);
                 break;
             } else if (gate.t == GateT::or_gate) {
                 const auto& o = ors[gate.at];
@@ -312,6 +447,8 @@ bool Common::remove_definable_by_gates() {
                     continue;
                 }
                 seen[v] = 0;
+                gate_defs.push_back({GateDefT::or_gate, {v}, {}});
+                for(auto& or_l: o.get_lhs()) gate_defs.back().inputs.push_back(or_l.var());
                 break;
             } else if (gate.t == GateT::ite_gate) {
                 const auto& ite = ites[gate.at];
@@ -328,6 +465,8 @@ bool Common::remove_definable_by_gates() {
                     continue;
                 }
                 seen[v] = 0;
+                gate_defs.push_back({GateDefT::ite_gate, {v}, {}});
+                for(auto& ite_l: ite.lhs) gate_defs.back().inputs.push_back(ite_l.var());
                 break;
             } else {
                 assert(false);
@@ -345,6 +484,8 @@ bool Common::remove_definable_by_gates() {
     bool changed = sampling_set.size() > new_sampl_set.size();
     std::swap(sampling_set, new_sampl_set);
 
+    phase.count("vars", old_size);
+    phase.count("removed", old_size-sampling_set.size());
     verb_print(1, "[arjun-simp] GATE-based"
         << " Potential was: " << potential
         << " Non-zero OCCs were: " << non_zero_occs
@@ -381,11 +522,21 @@ void Common::get_empty_occs() {
 
 void Common::remove_definable_by_irreg_gates() {
     assert(conf.irreg_gate_based);
+    PhaseTimer phase(phase_stats, "irreg-gates");
     double my_time = cpuTime();
     uint32_t old_size = sampling_set.size();
     order_sampl_set_for_simp();
 
+    const vector<uint32_t> old_set = sampling_set;
     sampling_set = solver->remove_definable_by_irreg_gate(sampling_set);
+    // Don't know the gates, only that the removed ones are defined by the rest
+    GateDef def{GateDefT::irreg, {}, sampling_set};
+    for(auto v: sampling_set) seen[v] = 1;
+    for(auto v: old_set) if (!seen[v]) def.defined.push_back(v);
+    for(auto v: sampling_set) seen[v] = 0;
+    if (!def.defined.empty()) gate_defs.push_back(std::move(def));
+    phase.count("vars", old_size);
+    phase.count("removed", old_size-sampling_set.size());
 
     verb_print(1, "[arjun-simp] IRREG-GATE-based"
         << " removed: " << (old_size-sampling_set.size())
@@ -394,6 +545,165 @@ void Common::remove_definable_by_irreg_gates() {
         << " T: " << (cpuTime() - my_time));
 }
 
+// Cache file of the formula, or empty if the cache is off. Keyed by the
+// formula, the sampling set and the gate config.
+string Common::gate_cache_fname() const
+{
+    if (conf.gate_cache_dir.empty() || orig_cnf.weighted) return string();
+    uint64_t no_gates_below;
+    memcpy(&no_gates_below, &conf.no_gates_below, sizeof(no_gates_below));
+    return conf.gate_cache_dir + "/" + formula_hash(sampling_set,
+        {(uint64_t)conf.xor_gates_based, (uint64_t)conf.or_gate_based,
+        (uint64_t)conf.ite_gate_based, (uint64_t)conf.irreg_gate_based,
+        (uint64_t)conf.probe_based, (uint64_t)conf.bve_pre_simplify, no_gates_below})
+        + ".arjdef";
+}
+
+// A missing file is a cache miss. So is a broken one, with a warning, since
+// it will simply be written again.
+bool Common::load_gate_cache(const string& fname, vector<GateDef>& defs)
+{
+    std::ifstream infile(fname);
+    if (!infile) {
+        verb_print(1, "[arjun-simp] gate cache miss, file: " << fname);
+        return false;
+    }
+    bool ok = true;
+    auto bad_file = [&](const string& what) {
+        if (ok) cout << "c WARNING: ignoring corrupt gate cache file '" << fname << "': " << what << endl;
+        ok = false;
+    };
+    auto read_vars = [&](vector<uint32_t>& vars) {
+        size_t num;
+        if (!(infile >> num) || num > orig_num_vars) return bad_file("bad number of variables");
+        vars.resize(num);
+        for(auto& v: vars) {
+            if (!(infile >> v) || v >= orig_num_vars) return bad_file("bad variable");
+        }
+    };
+
+    string line;
+    std::getline(infile, line);
+    if (line != "c arjun gate definition cache") bad_file("wrong header");
+    string tag;
+    uint32_t version;
+    if (ok && (!(infile >> tag >> version) || tag != "version" || version != 1)) bad_file("wrong version");
+    size_t num_defs = 0;
+    if (ok && (!(infile >> tag >> num_defs) || tag != "defs")) bad_file("expected defs");
+    defs.clear();
+    uint32_t dropped = 0;
+    for(size_t i = 0; ok && i < num_defs; i++) {
+        GateDef def;
+        if (!(infile >> tag)) {
+            bad_file("truncated");
+            break;
+        }
+        if (tag == "xor") def.t = GateDefT::xor_gate;
+        else if (tag == "or") def.t = GateDefT::or_gate;
+        else if (tag == "ite") def.t = GateDefT::ite_gate;
+        else if (tag == "irreg") def.t = GateDefT::irreg;
+        else bad_file("unknown gate type '" + tag + "'");
+        read_vars(def.defined);
+        read_vars(def.inputs);
+        if (!ok) break;
+
+        // A var defined by itself is no definition at all
+        for(auto v: def.inputs) seen[v] = 1;
+        bool self = false;
+        for(auto v: def.defined) self |= seen[v];
+        for(auto v: def.inputs) seen[v] = 0;
+        if (self) dropped++;
+        else defs.push_back(std::move(def));
+    }
+    if (!ok) {
+        defs.clear();
+        return false;
+    }
+    verb_print(1, "[arjun-simp] gate cache hit, file: " << fname
+        << " definitions: " << defs.size() << " dropped: " << dropped);
+    return true;
+}
+
+// Written via a temporary file and rename, so that runs sharing the cache
+// directory never read a half-written file. Failing is not fatal.
+void Common::save_gate_cache(const string& fname) const
+{
+    const string tmp_fname = fname + ".tmp" + std::to_string(std::random_device()());
+    std::ofstream outf(tmp_fname.c_str(), std::ios::out);
+    auto write_vars = [&](const vector<uint32_t>& vars) {
+        outf << " " << vars.size();
+        for(const auto& v: vars) outf << " " << v;
+    };
+    outf << "c arjun gate definition cache\n";
+    outf << "version 1\n";
+    outf << "defs " << gate_defs.size() << "\n";
+    for(const auto& def: gate_defs) {
+        switch(def.t) {
+            case GateDefT::xor_gate: outf << "xor"; break;
+            case GateDefT::or_gate: outf << "or"; break;
+            case GateDefT::ite_gate: outf << "ite"; break;
+            case GateDefT::irreg: outf << "irreg"; break;
+        }
+        write_vars(def.defined);
+        write_vars(def.inputs);
+        outf << "\n";
+    }
+    outf.close();
+    if (!outf || std::rename(tmp_fname.c_str(), fname.c_str()) != 0) {
+        cout << "c WARNING: could not write gate cache file '" << fname << "'" << endl;
+        std::remove(tmp_fname.c_str());
+        return;
+    }
+    verb_print(1, "[arjun-simp] gate cache written, file: " << fname
+        << " definitions: " << gate_defs.size());
+}
+
+// Replaces gate recovery on a cache hit. A definition is only used if all its
+// inputs are still in the sampling set, so no var is ever defined through
+// itself, whatever else happened to the sampling set in the meanwhile.
+void Common::apply_gate_defs(const vector<GateDef>& defs)
+{
+    PhaseTimer phase(phase_stats, "gate-cache");
+    double my_time = cpuTime();
+    uint32_t old_size = sampling_set.size();
+    for(auto v: sampling_set) seen[v] = 1;
+
+    uint32_t used = 0;
+    for(const auto& def: defs) {
+        bool ok = true;
+        for(auto v: def.inputs) {
+            if (!seen[v]) {
+                ok = false;
+                break;
+            }
+        }
+        if (!ok) continue;
+        bool removed = false;
+        for(auto v: def.defined) {
+            removed |= seen[v];
+            seen[v] = 0;
+        }
+        used += removed;
+        if (removed) gate_defs.push_back(def);
+    }
+
+    vector<uint32_t> new_sampl_set;
+    for(auto v: sampling_set) if (seen[v]) new_sampl_set.push_back(v);
+    for(auto v: sampling_set) seen[v] = 0;
+    std::swap(sampling_set, new_sampl_set);
+
+    phase.count("vars", old_size);
+    phase.count("defs", defs.size());
+    phase.count("removed", old_size-sampling_set.size());
+    verb_print(1, "[arjun-simp] GATE-CACHE-based"
+        << " defs: " << defs.size()
+        << " used: " << used
+        << " removed: " << (old_size-sampling_set.size())
+        << " perc: " << std::fixed << std::setprecision(2)
+        << stats_line_percent(old_size-sampling_set.size(), old_size)
+        << " T: " << (cpuTime() - my_time));
+}
+
 void Common::remove_zero_assigned_literals(bool print) {
     seen.clear();
     seen.resize(solver->nVars(), 0);
@@ -27,6 +27,7 @@ THE SOFTWARE.
 #include <ctime>
 #include <cstdint>
 
+#include <chrono>
 #include <ios>
 #include <iostream>
 #include <fstream>
@@ -78,6 +79,12 @@ static inline double cpuTimeTotal(void)
 
 #endif
 
+static inline double real_time_sec(void)
+{
+    using namespace std::chrono;
+    return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
 #if defined(__linux__)
 // process_mem_usage(double &, double &) - takes two doubles by reference,
 // attempts to read the system-dependent data for a process' virtual memory
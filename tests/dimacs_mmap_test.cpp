@@ -0,0 +1,233 @@
+/*
+ Arjun
+
+ Copyright (c) 2019-2020, Mate Soos and Kuldeep S. Meel. All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ */
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+#include "src/helper.h"
+
+using std::string;
+using std::vector;
+
+static int failed = 0;
+#define CHECK(x) do { if (!(x)) { \
+    std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #x << std::endl; \
+    failed++; } } while(0)
+
+// Records what the parser gives it
+struct TestSolver {
+    uint32_t nvars = 0;
+    vector<vector<Lit>> cls;
+    vector<vector<Lit>> red_cls;
+    vector<uint32_t> sampl;
+    std::map<Lit, double> weights;
+    mpz_class mult = 1;
+
+    uint32_t nVars() const { return nvars; }
+    void new_vars(const uint32_t n) { nvars += n; }
+    bool add_clause(const vector<Lit>& cl) { cls.push_back(cl); return true; }
+    bool add_red_clause(const vector<Lit>& cl) { red_cls.push_back(cl); return true; }
+    uint32_t set_sampl_vars(const vector<uint32_t>& vars) { sampl = vars; return 0; }
+    bool get_weighted() const { return true; }
+    void set_lit_weight(const Lit l, const double w) { weights[l] = w; }
+    void set_multiplier_weight(const mpz_class& m) { mult = m; }
+};
+
+static const string fname = "dimacs_mmap_test.cnf";
+
+static void write_file(const string& content)
+{
+    std::ofstream f(fname, std::ios::binary);
+    f << content;
+}
+
+// threads == 0 is parse(), otherwise parse_par()
+static bool parse(TestSolver& s, const uint32_t threads = 0)
+{
+    MmapDimacsParser<TestSolver> p(&s);
+    if (!p.map(fname)) return false;
+    return threads == 0 ? p.parse() : p.parse_par(threads);
+}
+
+static vector<Lit> cl(const vector<int>& dimacs)
+{
+    vector<Lit> ret;
+    for(const auto& l: dimacs) ret.push_back(Lit(std::abs(l)-1, l < 0));
+    return ret;
+}
+
+static void test_clauses_on_one_line()
+{
+    write_file("p cnf 4 2\n1 2 0 3 4 0\n");
+    TestSolver s;
+    CHECK(parse(s));
+    CHECK(s.cls.size() == 2);
+    if (s.cls.size() == 2) {
+        CHECK(s.cls[0] == cl({1, 2}));
+        CHECK(s.cls[1] == cl({3, 4}));
+    }
+}
+
+static void test_clause_over_lines()
+{
+    write_file("p cnf 3 2\n1 2\n-3 0 -1\n\n2 0 c done\n");
+    TestSolver s;
+    CHECK(parse(s));
+    CHECK(s.cls.size() == 2);
+    if (s.cls.size() == 2) {
+        CHECK(s.cls[0] == cl({1, 2, -3}));
+        CHECK(s.cls[1] == cl({-1, 2}));
+    }
+}
+
+static void test_weight_lines()
+{
+    write_file("p cnf 2 1\n1 2 0\n"
+        "c p weight -2 1\n"
+        "c p weight 2 2.5\n"
+        "c p weight 1 1e-05 0\n"
+        "c p weight -1 0.3\n");
+    TestSolver s;
+    CHECK(parse(s));
+    CHECK(s.weights.size() == 4);
+    CHECK(s.weights[cl({-2})[0]] == 1);
+    CHECK(s.weights[cl({2})[0]] == 2.5);
+    CHECK(s.weights[cl({1})[0]] == 1e-05);
+    CHECK(s.weights[cl({-1})[0]] == 0.3);
+
+    for(const string bad: {"c p weight 3 1\n", "c p weight 1\n", "c p weight 1 x\n", "c p weight 1 1 1\n"}) {
+        write_file("p cnf 2 0\n" + bad);
+        TestSolver s2;
+        CHECK(!parse(s2));
+    }
+}
+
+// What write_simpcnf() writes must be read back the same
+static void test_weighted_round_trip()
+{
+    ArjunNS::SimplifiedCNF cnf;
+    cnf.nvars = 5;
+    cnf.sampl_vars = {0, 3};
+    cnf.opt_sampl_vars = {0, 2, 3};
+    cnf.cnf.push_back(cl({1, -2, 3}));
+    cnf.cnf.push_back(cl({-4}));
+    cnf.cnf.push_back(cl({2, 5}));
+    cnf.red_cnf.push_back(cl({1, 5}));
+    cnf.multiplier_weight = 12;
+    cnf.weighted = true;
+    std::map<Lit, double> weights;
+    weights[cl({1})[0]] = 0.3;
+    weights[cl({-1})[0]] = 0.7;
+    weights[cl({4})[0]] = 2.5;
+    weights[cl({-5})[0]] = 1e-05;
+#ifdef WEIGHTED
+    cnf.weights = weights;
+    write_simpcnf(cnf, fname);
+#else
+    // Without WEIGHTED, SimplifiedCNF has no weights, add the same lines
+    write_simpcnf(cnf, fname);
+    string b;
+    append_weights(b, weights);
+    std::ofstream(fname, std::ios::app) << b;
+#endif
+
+    TestSolver s;
+    CHECK(parse(s));
+    CHECK(s.nvars == 5);
+    CHECK(s.cls.size() == 3);
+    if (s.cls.size() == 3) {
+        CHECK(s.cls[0] == cl({1, -2, 3}));
+        CHECK(s.cls[1] == cl({-4}));
+        CHECK(s.cls[2] == cl({2, 5}));
+    }
+    CHECK(s.red_cls.size() == 1);
+    if (s.red_cls.size() == 1) CHECK(s.red_cls[0] == cl({1, 5}));
+    CHECK(s.sampl == vector<uint32_t>({0, 3}));
+    CHECK(s.mult == 12);
+    CHECK(s.weights == weights);
+}
+
+// Chunks of parse_par() must not change what is read
+static void test_par_same_as_seq()
+{
+    string f = "c some comment\np cnf 40 0\n";
+    std::mt19937 rnd(7);
+    for(uint32_t i = 0; i < 300; i++) {
+        switch(rnd() % 8) {
+            case 0: f += "c comment " + std::to_string(i) + " 1 2 0\n"; break;
+            case 1: f += "c red " + std::to_string(rnd()%40+1) + " -3 0\n"; break;
+            case 2: f += "c ind " + std::to_string(rnd()%40+1) + " 0\n"; break;
+            default: {
+                const uint32_t sz = rnd() % 5;
+                for(uint32_t j = 0; j < sz; j++) {
+                    f += (rnd()%2 ? "-" : "") + std::to_string(rnd()%40+1);
+                    f += rnd()%6 == 0 ? "\n" : " ";
+                }
+                f += rnd()%3 == 0 ? "0 " : "0\n";
+            }
+        }
+    }
+    f += "\n";
+    write_file(f);
+
+    TestSolver seq;
+    CHECK(parse(seq));
+    CHECK(!seq.cls.empty());
+    for(uint32_t threads = 1; threads <= 8; threads++) {
+        TestSolver par;
+        CHECK(parse(par, threads));
+        CHECK(par.nvars == seq.nvars);
+        CHECK(par.cls == seq.cls);
+        CHECK(par.red_cls == seq.red_cls);
+        CHECK(par.sampl == seq.sampl);
+    }
+
+    for(const string bad: {"p cnf 2 1\n1 2\n", "p cnf 2 1\n1 3 0\n", "1 2 0\n", "p cnf 2 1\n1 a 0\n",
+            "0\np cnf 2 1\n1 2 0\n", "c x\n 0 \np cnf 2 0\n"}) {
+        write_file(bad);
+        for(uint32_t threads = 0; threads <= 3; threads++) {
+            TestSolver s;
+            CHECK(!parse(s, threads));
+        }
+    }
+}
+
+int main()
+{
+    test_clauses_on_one_line();
+    test_clause_over_lines();
+    test_weight_lines();
+    test_weighted_round_trip();
+    test_par_same_as_seq();
+    std::remove(fname.c_str());
+    if (failed) {
+        std::cerr << failed << " checks failed" << std::endl;
+        return 1;
+    }
+    return 0;
+}
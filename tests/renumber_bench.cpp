@@ -0,0 +1,94 @@
+/*
+ Arjun
+
+ Copyright (c) 2019-2020, Mate Soos and Kuldeep S. Meel. All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ */
+
+// Timing of SimplifiedCNF::map_lits_par(), the clause part of
+// renumber_sampling_vars_for_ganak(), to pick map_lits_min_per_thread.
+// Not a test, run it by hand:
+//   ./renumber_bench [threads]
+// For each size it maps the literals with 1 thread and with `threads`, with
+// no minimum per thread. It also prints what starting and joining a thread
+// costs, in literals mapped meanwhile.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+#include "src/arjun.h"
+#include "src/time_mem.h"
+
+using std::vector;
+using CMSat::Lit;
+using ArjunNS::SimplifiedCNF;
+
+// Best of `reps`, in seconds
+template<class F>
+static double best_time(const uint32_t reps, F f)
+{
+    double best = 1e100;
+    for(uint32_t i = 0; i < reps; i++) {
+        const double start = real_time_sec();
+        f();
+        best = std::min(best, real_time_sec() - start);
+    }
+    return best;
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t threads = argc > 1 ? std::atoi(argv[1]) : std::thread::hardware_concurrency();
+    threads = std::max<uint32_t>(threads, 2);
+    const uint32_t nvars = 1U << 20;
+    std::mt19937 rnd(1);
+    vector<uint32_t> v_map(nvars);
+    for(uint32_t i = 0; i < nvars; i++) v_map[i] = i;
+    std::shuffle(v_map.begin(), v_map.end(), rnd);
+
+    const double spawn = best_time(1000, []() { std::thread([]() {}).join(); });
+    std::cout << "threads: " << threads << " hardware threads: "
+        << std::thread::hardware_concurrency() << std::endl;
+
+    std::cout << std::setw(10) << "lits" << std::setw(14) << "1 thread ms"
+        << std::setw(14) << "N threads ms" << std::setw(10) << "speedup" << std::endl;
+    double per_lit = 0;
+    for(uint32_t lg = 12; lg <= 26; lg += 2) {
+        vector<Lit> lits(1ULL << lg);
+        for(auto& l: lits) l = Lit(rnd() % nvars, rnd() & 1);
+        const uint32_t reps = std::max(3, 1 << std::max(0, 20 - (int)lg));
+        const double one = best_time(reps, [&]() { SimplifiedCNF::map_lits_par(lits, v_map, 1, 1); });
+        const double par = best_time(reps, [&]() { SimplifiedCNF::map_lits_par(lits, v_map, threads, 1); });
+        per_lit = one / lits.size();
+        std::cout << std::setw(10) << lits.size()
+            << std::fixed << std::setprecision(3)
+            << std::setw(14) << one*1000 << std::setw(14) << par*1000
+            << std::setprecision(2) << std::setw(10) << one/par << std::endl;
+    }
+    std::cout << "thread start+join: " << std::setprecision(1) << spawn*1e6 << " us = "
+        << (uint64_t)(spawn/per_lit) << " literals mapped" << std::endl;
+    std::cout << "map_lits_min_per_thread: " << SimplifiedCNF::map_lits_min_per_thread << std::endl;
+    return 0;
+}
@@ -0,0 +1,158 @@
+/*
+ Arjun
+
+ Copyright (c) 2019-2020, Mate Soos and Kuldeep S. Meel. All rights reserved.
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "src/arjun.h"
+
+using std::vector;
+using CMSat::Lit;
+
+static int failed = 0;
+#define CHECK(x) do { if (!(x)) { \
+    std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #x << std::endl; \
+    failed++; } } while(0)
+
+// Random 3-CNF over the first `inputs` vars, then each further var is the AND
+// of two earlier ones, so it is defined by them
+static void add_formula(ArjunNS::Arjun& arj, const uint32_t inputs,
+        const uint32_t ands, const uint32_t seed)
+{
+    std::mt19937 rnd(seed);
+    const uint32_t nvars = inputs + ands;
+    arj.new_vars(nvars);
+    for(uint32_t i = 0; i < inputs; i++) {
+        vector<Lit> cl;
+        for(uint32_t j = 0; j < 3; j++) cl.push_back(Lit(rnd() % inputs, rnd() % 2));
+        arj.add_clause(cl);
+    }
+    for(uint32_t v = inputs; v < nvars; v++) {
+        const Lit a = Lit(rnd() % v, rnd() % 2);
+        const Lit b = Lit(rnd() % v, rnd() % 2);
+        arj.add_clause({Lit(v, true), a});
+        arj.add_clause({Lit(v, true), b});
+        arj.add_clause({Lit(v, false), ~a, ~b});
+    }
+    vector<uint32_t> sampl;
+    for(uint32_t v = 0; v < nvars; v++) sampl.push_back(v);
+    arj.set_sampl_vars(sampl);
+}
+
+static vector<uint32_t> indep(ArjunNS::Arjun& arj)
+{
+    auto ret = arj.run_backwards();
+    std::sort(ret.begin(), ret.end());
+    return ret;
+}
+
+static void configure(ArjunNS::Arjun& arj)
+{
+    arj.set_verbosity(0);
+    arj.set_seed(5);
+    arj.set_or_gate_based(true);
+}
+
+// A reset object must give what a new one gives on the same formula
+static void test_reset_same_as_new()
+{
+    ArjunNS::Arjun fresh;
+    configure(fresh);
+    add_formula(fresh, 30, 40, 1);
+    const auto expected = indep(fresh);
+    CHECK(!expected.empty());
+    CHECK(expected.size() < 70);
+
+    ArjunNS::Arjun reused;
+    configure(reused);
+    add_formula(reused, 20, 10, 2);
+    indep(reused);
+    reused.reset();
+    add_formula(reused, 30, 40, 1);
+    CHECK(indep(reused) == expected);
+
+    // Reset twice in a row, and with no formula in between
+    reused.reset();
+    reused.reset();
+    add_formula(reused, 30, 40, 1);
+    CHECK(indep(reused) == expected);
+}
+
+// Setters called after a formula was processed must survive reset(), and
+// options only turned off for that formula must be back
+static void test_reset_keeps_settings()
+{
+    ArjunNS::Arjun arj;
+    configure(arj);
+    add_formula(arj, 20, 10, 3);
+    indep(arj);
+    arj.set_backw_max_confl(1234);
+    arj.reset();
+    CHECK(arj.get_backw_max_confl() == 1234);
+    CHECK(arj.get_or_gate_based());
+}
+
+// The checkpoint is only for the formula it was resumed on, the next formula
+// after reset() must not try to resume from it
+static void test_reset_forgets_resume()
+{
+    const std::string fname = "reset_test.checkpoint";
+    ArjunNS::Arjun writer;
+    configure(writer);
+    writer.set_checkpoint_fname(fname);
+    add_formula(writer, 30, 40, 1);
+    const auto expected = indep(writer);
+
+    ArjunNS::Arjun other;
+    configure(other);
+    add_formula(other, 20, 10, 2);
+    const auto other_expected = indep(other);
+
+    ArjunNS::Arjun arj;
+    configure(arj);
+    arj.set_resume_fname(fname);
+    add_formula(arj, 30, 40, 1);
+    CHECK(indep(arj) == expected);
+    arj.reset();
+    CHECK(arj.get_resume_fname().empty());
+    add_formula(arj, 20, 10, 2);
+    CHECK(indep(arj) == other_expected);
+    std::remove(fname.c_str());
+}
+
+int main()
+{
+    test_reset_same_as_new();
+    test_reset_keeps_settings();
+    test_reset_forgets_resume();
+    if (failed) {
+        std::cerr << failed << " checks failed" << std::endl;
+        return 1;
+    }
+    return 0;
+}